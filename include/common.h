@@ -8,6 +8,8 @@
 
 #include <stdint.h>
 
+#include "rbtree.h"
+
 #ifndef OSCFG_H
 #include "os-cfg.h"
 #endif
@@ -32,7 +34,10 @@ enum ins_opcode_t
     ALLOC, // Allocate memory
     FREE,  // Deallocated a memory block
     READ,  // Write data to a byte on memory
-    WRITE  // Read data from a byte on memory
+    WRITE, // Read data from a byte on memory
+    LOOP,  // Set the counter register
+    JMP,   // Jump to an instruction
+    JNZ    // Decrement the counter, and jump while it is not zero
 };
 
 /* instructions executed by the CPU */
@@ -44,10 +49,28 @@ struct inst_t
     uint32_t arg_2;
 };
 
+/**
+ * @brief
+ *      An instruction pre-decoded by decode(): the handler which runs it in
+ * the dispatch loop of the CPU, and its operands.
+ *
+ *  run : instructions from this one on that its handler runs at once, see
+ *        fuse() in loader.c. Each one of a run still counts as one.
+ */
+struct op_t
+{
+    const void *handler;
+    uint32_t arg_0;
+    uint32_t arg_1;
+    uint32_t arg_2;
+    uint32_t run;
+};
+
 struct code_seg_t
 {
     struct inst_t *text;
     uint32_t size;
+    struct op_t *ops; // `text` pre-decoded, NULL until decode()
 };
 
 struct trans_table_t
@@ -73,6 +96,18 @@ struct page_table_t
     int size; // Number of row in the first layer
 };
 
+/* Scheduling statistics of a process, in slots. See stats.h */
+struct pcb_stats_t
+{
+    uint64_t arrival;     // when the loader added it
+    uint64_t first_run;   // its first dispatch
+    uint64_t ready_since; // when it last entered the ready queue
+    uint64_t wait;        // total time in the ready queue
+    uint32_t dispatches;
+    uint32_t slots; // executed slots
+    uint64_t insts; // executed instructions, up to a clock of them a slot
+};
+
 /**
  * @brief
  *      PCB, describe information about a process. This struct is associated
@@ -88,10 +123,20 @@ struct pcb_t
     struct code_seg_t *code; // Code segment
     addr_t regs[10];         // Registers, store address of allocated regions
     uint32_t pc;             // Program pointer, point to the next instruction
+    uint32_t counter;        // Counter register, set by LOOP, used by JNZ
 #ifdef MLQ_SCHED
     // Priority on execution (if supported), on-fly aka. changeable
     // and this vale overwrites the default priority when it existed
     uint32_t prio;
+    uint64_t vruntime;          // CFS virtual runtime, weighted by prio
+    struct rb_node_t run_node;  // CFS ready tree linkage
+    uint64_t queued_at;         // MLQ dispatch clock of its CPU when queued
+    uint32_t boost;             // MLQ levels raised by aging while queued
+    uint64_t deadline;          // EDF absolute deadline in slots, 0 if none
+    uint32_t edf_util;          // EDF admitted CPU share, see sched.h
+    uint32_t mlfq_level;        // MLFQ level, 0 is the highest
+    uint32_t mlfq_ran;          // MLFQ slots run at that level
+    uint32_t mlfq_epoch;        // MLFQ boosts seen, see sched-mlfq.c
 #endif
 #ifdef MM_PAGING
     struct mm_struct *mm;
@@ -104,6 +149,8 @@ struct pcb_t
      */
     struct page_table_t *page_table; // Page table (DEPRECATED)
     uint32_t bp;                     // Break pointer
+    struct pcb_stats_t stats;        // Scheduling statistics
+    int last_cpu;                    // CPU it last ran on, -1 if none
 };
 
 /**
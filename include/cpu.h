@@ -15,4 +15,20 @@
 */
 int run (struct pcb_t *proc);
 
+/**
+ * @brief
+ *      Pre-decode `code` for run_ops(): every instruction becomes the address
+ * of its handler in the dispatch loop, with its operands. The loader calls
+ * it, run_ops() does on first use otherwise.
+ */
+void decode (struct code_seg_t *code);
+
+/**
+ * @brief Execute up to `budget` instructions in a process, from its program
+ * counter, and move the program counter past them.
+ * @return the number of instructions executed, less than `budget` at the end
+ *      of the code.
+ */
+int run_ops (struct pcb_t *proc, int budget);
+
 #endif
@@ -0,0 +1,70 @@
+/**
+ * @file log.h
+ * @category Interface file
+ * @brief
+ *      Log of the simulation, written behind the threads' back.
+ *
+ *      Every thread formats its lines into its own queue, stamped with the
+ * current slot, without any lock. A flusher thread writes them to stdout
+ * once their slot is over: slot by slot, and within a slot by source, so
+ * the timer and the loader (source 0) come first, then CPU 0, 1, ... The
+ * order no longer depends on which thread got stdout first.
+ *
+ *      Before log_init() and after log_finish(), lines are printed right
+ * away.
+ */
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+
+/* Verbosity levels, each one shows the lines of the ones below */
+#define LOG_ERROR 0 // errors only
+#define LOG_INFO 1  // time slots, loads, dispatches, allocations
+#define LOG_IO 2    // memory reads and writes, with the physical memory
+#define LOG_DUMP 3  // the page table along with them
+
+#define LOG_LINE_MAX 128     // longer lines are cut
+#define LOG_CHUNK_LINES 64   // lines per chunk of a thread's queue
+#define LOG_FLUSH_SLOTS 8    // slots between two wake-ups of the flusher
+
+/* Start the flusher. log_finish() runs at exit, if not called before */
+void log_init (void);
+
+/* Write all pending lines, stop the flusher */
+void log_finish (void);
+
+/* Set the verbosity, LOG_DEFAULT_LEVEL at start */
+void log_set_level (int level);
+
+/**
+ * @brief
+ *      Parse a verbosity: a level number, or error, info, io or dump.
+ *
+ * @return The level, -1 if unknown.
+ */
+int log_parse_level (const char *name);
+
+/* Whether lines of `level` are shown */
+int log_enabled (int level);
+
+/**
+ * @brief
+ *      Set the source of the calling thread, the order of its lines within
+ * a slot. Threads are source 0 by default. A thread may switch sources,
+ * e.g. to run several CPUs in turn, it then has a queue for each.
+ */
+void log_set_source (int source);
+
+/**
+ * @brief
+ *      Tell the log the clock has moved to `slot`: the lines of the slots
+ * before are complete, and may be written out. Called by the timer.
+ */
+void log_set_slot (uint64_t slot);
+
+/* Log a line of `level`, in printf() format */
+void log_printf (int level, const char *fmt, ...)
+    __attribute__ ((format (printf, 2, 3)));
+
+#endif
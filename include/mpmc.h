@@ -0,0 +1,75 @@
+/**
+ * @file mpmc.h
+ * @category Interface file
+ * @brief
+ *      Bounded lock-free multi-producer/multi-consumer queue of processes.
+ *
+ *      This is Dmitry Vyukov's array queue: every cell carries a sequence
+ * number telling whether it is ready to be written (seq == pos) or to be
+ * read (seq == pos + 1) by the producer/consumer that claimed position
+ * `pos`. Producers and consumers only contend on one CAS each, there is no
+ * lock anywhere.
+ */
+#ifndef MPMC_H
+#define MPMC_H
+
+#include "common.h"
+
+#define CACHE_LINE_SIZE 64
+
+struct mpmc_cell_t
+{
+    unsigned long seq;
+    struct pcb_t *proc;
+};
+
+/**
+ * @brief
+ *      Lock-free queue. The producer and consumer positions live on their
+ * own cache lines, so enqueuers and dequeuers do not false-share.
+ *
+ * @note A zero-initialized mpmc_queue_t must be set up with mpmc_init()
+ * before use.
+ */
+struct mpmc_queue_t
+{
+    struct mpmc_cell_t *cells;
+    unsigned long mask; // capacity - 1
+    unsigned long enqueue_pos __attribute__ ((aligned (CACHE_LINE_SIZE)));
+    unsigned long dequeue_pos __attribute__ ((aligned (CACHE_LINE_SIZE)));
+} __attribute__ ((aligned (CACHE_LINE_SIZE)));
+
+/**
+ * @brief
+ *      Allocate the cells of the queue. `capacity` is rounded up to a power
+ *      of two (at least 2).
+ *
+ * @return 0 on success, -1 on out of memory.
+ */
+int mpmc_init (struct mpmc_queue_t *q, unsigned long capacity);
+
+/**
+ * @brief
+ *      Reclaim the cells of the queue. The pcb_t(s) are NOT destroyed.
+ */
+void mpmc_destroy (struct mpmc_queue_t *q);
+
+/**
+ * @brief
+ *      Add a process at the rear of the queue. Safe to call from any number
+ *      of threads.
+ *
+ * @return 0 on success, -1 if the queue is full.
+ */
+int mpmc_enqueue (struct mpmc_queue_t *q, struct pcb_t *proc);
+
+/**
+ * @brief
+ *      Remove the process at the front of the queue. Safe to call from any
+ *      number of threads.
+ *
+ * @return A ptr to the dequeued pcb_t, NULL if the queue is empty.
+ */
+struct pcb_t *mpmc_dequeue (struct mpmc_queue_t *q);
+
+#endif // MPMC_H
@@ -2,13 +2,28 @@
 #define OSCFG_H
 
 #define MLQ_SCHED 1
+#ifndef MAX_PRIO // may be overridden from the command line, e.g. bench-sched
 #define MAX_PRIO 140
+#endif
+// #define MLQ_LOCKFREE 1 // back each MLQ level with a lock-free queue
+#define MLQ_LOCKFREE_CAP 1024 // capacity of a lock-free MLQ level
+#define CFS_TARGET_LATENCY 20 // slots in which every ready process runs once
+#define CFS_MIN_GRANULARITY 2 // the shortest CFS quantum, in slots
+#define MLQ_AGING_RATE 0  // dispatches a queued process waits per MLQ level it
+                          // is raised, 0 disables aging unless an `aging`
+                          // line sets it
+#define MLFQ_LEVELS 4 // MLFQ levels, unless a quanta table is configured
+#define MLFQ_MAX_LEVELS 8 // the longest MLFQ quanta table
+#define MLFQ_BOOST_PERIOD 200 // slots between two MLFQ resets to level 0
+#define EDF_MAX_UTIL 90 // % of the CPUs the deadline processes may claim
+#define SCHED_AFFINITY_LOOKAHEAD 4 // queued processes scanned for a cache-hot
+                                   // one, 0 to dispatch in plain FIFO order
 
 #define MM_PAGING
 // #define MM_FIXED_MEMSZ
 // #define VMDBG 1
 // #define MMDBG 1
-#define IODUMP 1
-#define PAGETBL_DUMP 1
+#define LOG_DEFAULT_LEVEL 3 // 0 errors, 1 scheduling, 2 memory I/O, 3 page
+                            // tables, or set by a `log` config line
 
 #endif
@@ -4,40 +4,56 @@
 
 #include "common.h"
 
-#define MAX_QUEUE_SIZE 10
+#define QUEUE_INIT_CAP 16 // Capacity of a queue on its first enqueue()
 #define MAX_INT 1000000
 /**
- * @brief Array-based queue. 
- * Three attributes:
- *      proc : a pointer to a stack-allocated contiguous array
- *      size : dynamic size, a counter of processes. New processes
- *              will be added at position size-th.
+ * @brief Growable ring buffer queue. 
+ * Attributes:
+ *      proc : a contiguous view of the queued processes, front first.
+ *              proc[i] is the i-th process from the front, 0 <= i < size.
+ *      size : dynamic size, a counter of processes.
  *      slots : number of round-robin quantum time spared for a queue.
- * 
+ *
  * @note This queue should be initialized and deinitialized with init_queue()
  * and destroy_queue(). Any direct access to the attributes are deprecated.
  * Since it is not safe to have any external code to access into the queue
  * internals.
- * 
+ *
+ * @note A zero-initialized queue_t is a valid empty queue, so it can be
+ * embedded in other structs. Use release_queue() to reclaim its storage.
+ *
+ * @note The ring buffer is mirrored: `buf` has 2 * cap entries and
+ * buf[i] == buf[i + cap]. `proc` points at the front element inside `buf`,
+ * so the queue can always be read as a plain array although enqueue() and
+ * dequeue() are O(1) and never shift anything.
  */
 struct queue_t
 {
-    struct pcb_t *proc[MAX_QUEUE_SIZE]; // ptr to contiguous array
+    struct pcb_t **proc; // contiguous view, always buf + head
     int size; // Number of processes in queue, dynamically changes as the queue
               // grow
     int slots; // Number of time slots used by the queue
+
+    struct pcb_t **buf; // mirrored storage of 2 * cap entries
+    int head;           // position of the front element in buf
+    int cap;            // capacity, a power of two. 0 before first use
+
+    /* Priority mode only, see enqueue_prio() */
+    unsigned long long *keys; // heap keys, (key << 32) | arrival number
+    unsigned int seq;         // arrival counter, for FIFO tie-breaking
+
+    struct pcb_t *passed; // front process last passed over by dequeue_affine
 };
 
 /**
  * @brief
- *      Add a new process into the queue in a `sorted` manner. So that we can
- *      retrieve the process with least priority easily.
+ *      Add a new process at the rear of the queue. The queue doubles its
+ *      capacity when it is full, processes are never dropped silently.
  *
- * @note
- *      Although MLQ algorithm never uses priorities within queue, just
- * implement it - NK.
+ * @return 0 on success, -1 if the queue is full and can not grow (out of
+ * memory). The process is not queued in that case.
  */
-void enqueue (struct queue_t *q, struct pcb_t *proc);
+int enqueue (struct queue_t *q, struct pcb_t *proc);
 
 /**
  * @brief
@@ -48,6 +64,58 @@ void enqueue (struct queue_t *q, struct pcb_t *proc);
  */
 struct pcb_t *dequeue (struct queue_t *q);
 
+/**
+ * @brief
+ *      Remove the element at the rear of the queue, i.e. the one which has
+ * been enqueued last.
+ *
+ * @return A ptr to the removed pcb_t, NULL if the queue is empty.
+ */
+struct pcb_t *dequeue_tail (struct queue_t *q);
+
+/**
+ * @brief
+ *      Remove the first of the `lookahead` processes at the front of the
+ * queue which last ran on CPU `cpu`, or the front one if there is none.
+ * The other processes keep their order. The front process is passed over
+ * only once, so that a process which is cache-cold everywhere does not
+ * starve behind cache-hot ones.
+ *
+ * @return A ptr to the removed pcb_t, NULL if the queue is empty.
+ */
+struct pcb_t *dequeue_affine (struct queue_t *q, int cpu, int lookahead);
+
+/**
+ * @brief
+ *      Add a new process into the queue, ordered by `key` (the smaller the
+ *      sooner it is dequeued). Processes with the same key are dequeued in
+ *      First-in First-out order.
+ *
+ * @note
+ *      The queue is then a binary min-heap: enqueue_prio() and
+ * dequeue_prio() are O(log n). A queue must be used either with
+ * enqueue()/dequeue() or with the *_prio() functions, not both.
+ *
+ * @return 0 on success, -1 if the queue is full and can not grow.
+ */
+int enqueue_prio (struct queue_t *q, struct pcb_t *proc, uint32_t key);
+
+/**
+ * @brief
+ *      Get the process with the least key, and remove it from the queue.
+ *
+ * @return A ptr to the dequeued pcb_t, NULL if the queue is empty.
+ */
+struct pcb_t *dequeue_prio (struct queue_t *q);
+
+/**
+ * @brief
+ *      Get the process with the least key, without removing it.
+ *
+ * @return A ptr to that pcb_t, NULL if the queue is empty.
+ */
+struct pcb_t *peek_prio (struct queue_t *q);
+
 /**
  * @brief
  *      Check if the queue is empty or not
@@ -62,6 +130,17 @@ int empty (struct queue_t *q);
  */
 struct queue_t *init_queue ();
 
+/**
+ * @brief
+ *      Reclaim the storage of a queue that was not created by init_queue(),
+ *      e.g. a queue embedded in another struct. The queue is empty and
+ *      reusable afterwards.
+ *
+ * @brief
+ *      The pcb_t(s) controlled by this queue is NOT automatically destroyed.
+ */
+void release_queue (struct queue_t *q);
+
 /**
  * @brief
  *      Reclaim memory allocated for queue
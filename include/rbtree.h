@@ -0,0 +1,73 @@
+/**
+ * @file rbtree.h
+ * @category Interface file
+ * @brief
+ *      Intrusive red-black tree with a cached leftmost node.
+ *
+ *      The tree never allocates: a struct to be sorted embeds a rb_node_t,
+ * and rb_entry() gets the struct back from its node. The order is given by
+ * a `less` callback on insertion, nodes comparing equal are kept in
+ * insertion order. rb_first() is O(1), insertion and removal O(log n).
+ */
+#ifndef RBTREE_H
+#define RBTREE_H
+
+#include <stddef.h>
+
+#define RB_RED 0
+#define RB_BLACK 1
+
+struct rb_node_t
+{
+    struct rb_node_t *parent;
+    struct rb_node_t *left;
+    struct rb_node_t *right;
+    int color;
+};
+
+/**
+ * @brief
+ *      A red-black tree. `leftmost` caches its least node.
+ *
+ * @note A zero-initialized rb_tree_t is a valid empty tree.
+ */
+struct rb_tree_t
+{
+    struct rb_node_t *root;
+    struct rb_node_t *leftmost;
+};
+
+/* Get the struct of type `type` whose rb_node_t `member` is at `ptr` */
+#define rb_entry(ptr, type, member)                                           \
+    ((type *)((char *)(ptr) - offsetof (type, member)))
+
+/**
+ * @brief
+ *      Link `node` into `tree`, after all nodes that are not greater than
+ *      it, i.e. `less(node, other)` decides whether it goes to the left.
+ */
+void rb_insert (struct rb_tree_t *tree, struct rb_node_t *node,
+                int (*less) (const struct rb_node_t *,
+                             const struct rb_node_t *));
+
+/**
+ * @brief
+ *      Unlink `node` from `tree`. The node must be in that tree.
+ */
+void rb_erase (struct rb_tree_t *tree, struct rb_node_t *node);
+
+/**
+ * @return The least node of `tree`, NULL if the tree is empty.
+ */
+static inline struct rb_node_t *
+rb_first (const struct rb_tree_t *tree)
+{
+    return tree->leftmost;
+}
+
+/**
+ * @return The node following `node` in order, NULL if it is the last one.
+ */
+struct rb_node_t *rb_next (const struct rb_node_t *node);
+
+#endif // RBTREE_H
@@ -0,0 +1,87 @@
+/**
+ * @file sched-class.h
+ * @category Interface file
+ * @brief
+ *      Scheduling policies, behind one table of operations.
+ *
+ *      sched.c dispatches get_proc()/put_proc()/add_proc() and friends to
+ * the policy picked by init_scheduler_policy(). A policy fills a
+ * sched_class_t and is registered in the `sched_classes` table of sched.c.
+ * This header is for the policies only, the rest of the OS uses sched.h.
+ */
+#ifndef SCHED_CLASS_H
+#define SCHED_CLASS_H
+
+#include "common.h"
+
+/* `cpu` of enqueue() for a new process: the policy picks the CPU */
+#define SCHED_NEW_PROC -1
+
+/**
+ * @brief
+ *      Operations of a scheduling policy. Optional operations may be NULL.
+ *
+ *  init       : set up the run queues of `num_cpus` CPUs.
+ *  finish     : free them. Queued pcb_t(s) are NOT destroyed.
+ *  enqueue    : put `proc` back to the run queue of `cpu`, or place a new
+ *               process if `cpu` is SCHED_NEW_PROC.
+ *  pick_next  : take the next process to run on `cpu` out of the run
+ *               queues, NULL if there is none.
+ *  time_slice : (optional) quantum of `proc`, just picked on `cpu`.
+ *               `time_slot` is used when NULL.
+ *  on_tick    : (optional) `proc` has run one slot on `cpu`, the slot
+ *               `now` of the simulation.
+ *  on_exit    : (optional) `proc` has finished on `cpu`, and is about to
+ *               be freed.
+ *  stats      : (optional) print the counters of the policy.
+ *  rank       : (optional) urgency of `proc`, the lower the more urgent.
+ *               A new process preempts the CPU running the process of the
+ *               highest rank above its own. No preemption when NULL.
+ *  migrate    : (optional) move the processes queued on the offline `cpu`
+ *               to the online CPUs, return how many. NULL when the run
+ *               queues are shared by all CPUs.
+ *
+ * @note
+ *      All operations but init and finish may be called concurrently from
+ * every CPU and the loader.
+ */
+struct sched_class_t
+{
+    const char *name;
+    void (*init) (int num_cpus);
+    void (*finish) (void);
+    void (*enqueue) (int cpu, struct pcb_t *proc);
+    struct pcb_t *(*pick_next) (int cpu);
+    int (*time_slice) (int cpu, struct pcb_t *proc, int time_slot);
+    void (*on_tick) (int cpu, struct pcb_t *proc, uint64_t now);
+    void (*on_exit) (int cpu, struct pcb_t *proc);
+    void (*stats) (void);
+    int (*rank) (struct pcb_t *proc);
+    int (*migrate) (int cpu);
+};
+
+extern const struct sched_class_t mlq_sched_class;
+extern const struct sched_class_t cfs_sched_class;
+extern const struct sched_class_t mlfq_sched_class;
+extern const struct sched_class_t prio_sched_class;
+extern const struct sched_class_t rr_sched_class;
+
+/* Shared by the policies, owned by sched.c */
+extern int sched_nr_cpus;
+
+/**
+ * @brief
+ *      Add `delta` to the number of queued processes of all policies, read
+ * by queue_empty().
+ */
+void sched_account (int delta);
+
+/**
+ * @brief
+ *      Pick the CPU for a new process: the online one with the least
+ * queued processes by `nr_queued`. Ties are broken in a round-robin manner,
+ * so that new processes spread over idle CPUs.
+ */
+int sched_pick_cpu (int (*nr_queued) (int cpu));
+
+#endif // SCHED_CLASS_H
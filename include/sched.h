@@ -17,9 +17,64 @@
  */
 int queue_empty (void);
 
-/* Initialize MLQ scheduler */
+/**
+ * @brief
+ *      Initialize the scheduling policy named `name` for `num_cpus` CPUs,
+ * numbered from 0 to num_cpus - 1. The policies are "mlq" (the default),
+ * "cfs", "mlfq" (multi-level feedback queue), "prio" (plain priority) and
+ * "rr" (round-robin).
+ *
+ * @return 0 on success, -1 if there is no such policy.
+ */
+int init_scheduler_policy (const char *name, int num_cpus);
+
+/* Initialize MLQ scheduler, with a single CPU */
 void init_scheduler (void);
 
+/**
+ * @brief
+ *      Initialize MLQ scheduler for `num_cpus` CPUs. Each CPU owns a whole
+ * MLQ, CPUs are numbered from 0 to num_cpus - 1.
+ */
+void init_scheduler_smp (int num_cpus);
+
+/**
+ * @brief
+ *      Initialize the completely fair scheduler (CFS) for `num_cpus` CPUs,
+ * instead of the MLQ. Each CPU owns a red-black tree of ready processes
+ * sorted by virtual runtime, and always dispatches the leftmost one.
+ */
+void init_scheduler_cfs (int num_cpus);
+
+/**
+ * @brief
+ *      Set the MLQ aging rate: a queued process is raised one level for
+ * every `rate` dispatches of its CPU it waits, until it is dispatched.
+ * 0 disables aging. Defaults to MLQ_AGING_RATE, or 0 with MLQ_LOCKFREE.
+ *
+ * @return 0 on success, -1 if `rate` is nonzero with MLQ_LOCKFREE, whose
+ * levels can not be aged.
+ */
+int sched_set_aging (int rate);
+
+/**
+ * @brief
+ *      Set the clock: the instructions a CPU runs in a slot, 1 by default.
+ * The deadline processes are admitted on their length in slots.
+ */
+void sched_set_clock (int rate);
+
+/**
+ * @brief
+ *      Set the quanta of the `n` MLFQ levels, in slots, from the highest
+ * level. Without a table, there are MLFQ_LEVELS levels and the quantum of
+ * level `l` is `time_slot << l`.
+ *
+ * @return 0 on success, -1 if `n` is not within 1..MLFQ_MAX_LEVELS or a
+ * quantum is not positive.
+ */
+int sched_set_mlfq_quanta (const int *quanta, int n);
+
 /* Free the allocated resources by che scheduler */
 void finish_scheduler (void);
 
@@ -40,13 +95,124 @@ struct pcb_t *get_proc (void);
  */
 void put_proc (struct pcb_t *proc);
 
+/**
+ * @brief
+ *      Get the process from the MLQ of CPU `cpu`, and delete that process
+ * from MLQ. If that MLQ is empty, steal a process from the busiest CPU.
+ * The process is recorded to have last run on `cpu`.
+ *
+ * @return A ptr to `pcb_t`, NULL if no CPU has a ready process.
+ */
+struct pcb_t *get_cpu_proc (int cpu);
+
+/**
+ * @brief
+ *      Put a process back to the MLQ of CPU `cpu`.
+ */
+void put_cpu_proc (int cpu, struct pcb_t *proc);
+
 /**
  * @brief 
- *      Put a process back to the MLQ. This is an alias for put_proc().
+ *      Put a new process to the MLQ of the least loaded CPU. Under the MLQ
+ * and prio policies, when no CPU is idle, a process of better `prio` than a
+ * running one is sent to the CPU running the worst `prio` instead, which is
+ * asked to preempt it, see sched_need_resched().
  * 
  * @note
  *      The original 'Put a process back to run queue'-documentation is outdated.
  */
 void add_proc (struct pcb_t *proc);
 
+#define EDF_UTIL_UNIT 1000 // A whole CPU, as a share of sched_admit_deadline()
+
+/**
+ * @brief
+ *      Admission control of the earliest deadline first (EDF) class. `proc`,
+ * arriving at `now`, asks to finish within `relative` slots. Its CPU share
+ * is its length in slots, see sched_set_clock(), over `relative`, in
+ * 1/EDF_UTIL_UNIT of a CPU. It is admitted if the shares of all admitted
+ * processes stay within EDF_MAX_UTIL % of the CPUs. A process whose code
+ * jumps backward has no length known in advance, and is never admitted.
+ *
+ *      Admitted processes are dispatched before those of the policy, by
+ * earliest deadline, from one queue shared by all CPUs. Their share is
+ * released by sched_exit().
+ *
+ * @return 0 if admitted, then `proc` has a deadline. -1 otherwise, `proc`
+ * is then left to the policy.
+ */
+int sched_admit_deadline (struct pcb_t *proc, uint64_t now,
+                          uint64_t relative);
+
+/**
+ * @brief
+ *      Park the idle CPU `cpu`: it should not look into the ready queues
+ * until add_proc() or put_cpu_proc() queues a process and wakes it up,
+ * which sched_parked() tells. It still has to go through the time slots.
+ *
+ * @return 0 if parked, -1 if a process has been queued meanwhile.
+ */
+int sched_park (int cpu);
+
+/* Whether CPU `cpu` is parked, see sched_park() */
+int sched_parked (int cpu);
+
+/**
+ * @brief
+ *      Bring CPU `cpu` online or offline, at a slot boundary. All CPUs are
+ * online after init_scheduler_policy(). An offline CPU gets no new process,
+ * and no deadline share. It must put its process back, then hand its
+ * queued ones over with sched_migrate(), before it stops.
+ *
+ * @return 0, -1 if there is no such CPU.
+ */
+int sched_set_online (int cpu, int online);
+
+/* Whether CPU `cpu` is online, see sched_set_online() */
+int sched_online (int cpu);
+
+/**
+ * @brief
+ *      Move the processes queued on the offline CPU `cpu` to the online
+ * ones, and wake up idle CPUs to run them.
+ */
+void sched_migrate (int cpu);
+
+/**
+ * @brief
+ *      Check whether CPU `cpu` must put its process back at this slot
+ * boundary, since add_proc() has queued a more urgent one for it. The
+ * request is cleared, and counted as a preemption.
+ *
+ * @return 1 if the process must be put back, 0 otherwise.
+ */
+int sched_need_resched (int cpu);
+
+/**
+ * @brief
+ *      Get the quantum of `proc`, just dispatched on CPU `cpu`, in slots.
+ *
+ * @return `time_slot` under the MLQ. Under CFS, the share of
+ * CFS_TARGET_LATENCY owed to `proc` by its weight, at least
+ * CFS_MIN_GRANULARITY.
+ */
+int get_time_slice (int cpu, struct pcb_t *proc, int time_slot);
+
+/**
+ * @brief
+ *      Account one slot of execution of `proc` on CPU `cpu`, the slot `now`
+ * of the simulation. Under CFS, this advances the vruntime of `proc`.
+ */
+void sched_tick (int cpu, struct pcb_t *proc, uint64_t now);
+
+/**
+ * @brief
+ *      Tell the policy that `proc` has finished on CPU `cpu`. Must be called
+ * before `proc` is freed.
+ */
+void sched_exit (int cpu, struct pcb_t *proc);
+
+/* Print the counters of the policy, at shutdown */
+void sched_stats (void);
+
 #endif // SCHED_H
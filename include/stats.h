@@ -0,0 +1,87 @@
+/**
+ * @file stats.h
+ * @category Interface file
+ * @brief
+ *      Per-process scheduling statistics.
+ *
+ *      The CPUs and the loader report the life events of every process:
+ * arrival, dispatch, put-back and finish. When a process finishes, its
+ * wait time (slots spent in the ready queue), response time (first
+ * dispatch minus arrival), turnaround time, number of dispatches, executed
+ * slots and instructions are recorded. At shutdown, stats_report() prints
+ * their p50/p90/p99 per priority level and per CPU, with the number of
+ * missed deadlines, and stats_write_csv() dumps one row per process.
+ *
+ *      All times are in slots, as given by the caller in `now`.
+ */
+#ifndef STATS_H
+#define STATS_H
+
+#include "common.h"
+#include <stdio.h>
+
+/* One finished process */
+struct stats_record_t
+{
+    uint32_t pid;
+    uint32_t prio;
+    int cpu; // the CPU it finished on
+    uint64_t arrival;
+    uint64_t first_run;
+    uint64_t finish;
+    uint64_t wait;
+    uint64_t response;
+    uint64_t turnaround;
+    uint32_t dispatches;
+    uint32_t slots;
+    uint64_t insts;
+    uint64_t deadline; // absolute, 0 if none
+};
+
+/* Forget all records, and set the number of CPUs to report on */
+void stats_init (int num_cpus);
+
+/* Free the records */
+void stats_finish (void);
+
+/* `proc` has been loaded, and is about to be added to the ready queue */
+void stats_arrive (struct pcb_t *proc, uint64_t now);
+
+/* `proc` has been dispatched on CPU `cpu` */
+void stats_dispatch (int cpu, struct pcb_t *proc, uint64_t now);
+
+/* `proc` has run for one slot, `insts` instructions in it */
+static inline void
+stats_run (struct pcb_t *proc, int insts)
+{
+    proc->stats.slots++;
+    proc->stats.insts += insts;
+}
+
+/* `proc` is about to be put back to the ready queue */
+void stats_put (struct pcb_t *proc, uint64_t now);
+
+/* `proc` has finished on CPU `cpu`, record it */
+void stats_exit (int cpu, struct pcb_t *proc, uint64_t now);
+
+/**
+ * @brief
+ *      Get the `p`-th percentile of the `n` sorted values, by the nearest
+ *      rank method.
+ *
+ * @return That value, 0 if `n` is 0.
+ */
+uint64_t stats_percentile (const uint64_t *sorted, int n, int p);
+
+/* Print the percentiles per priority level and per CPU */
+void stats_report (FILE *out);
+
+/**
+ * @brief
+ *      Write one line per finished process to the CSV file at `path`.
+ *
+ * @return 0 on success, -1 if the file can not be written.
+ */
+int stats_write_csv (const char *path);
+
+#endif // STATS_H
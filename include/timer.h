@@ -4,26 +4,125 @@
 #include <pthread.h>
 #include <stdint.h>
 
+/* `wake` of a device with nothing to do until another device runs */
+#define TIMER_WAKE_IDLE UINT64_MAX
+
+#define TIMER_MAX_DEVICES 1024 // CPUs and loader attached to the timer
+#define TIMER_CACHE_LINE 64
+#define TIMER_SPIN 200 // polls of the barrier before sleeping on a futex
+
+/* Timing wheel: TIMER_WHEEL_LEVELS levels of 2^TIMER_WHEEL_BITS buckets */
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SIZE (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+
+/**
+ * @brief
+ *      Per-device state of the slot barrier, one cache line each, so that
+ * devices do not invalidate each other when they arrive.
+ *
+ *  fsh     : the device has detached, the timer no longer waits for it.
+ *  wake    : slot to resume at, 0 for the next slot.
+ *  release : generation of the barrier at which the timer last resumed it.
+ */
 struct timer_id_t
 {
-    int done;
     int fsh;
-    pthread_cond_t event_cond;
-    pthread_mutex_t event_lock;
-    pthread_cond_t timer_cond;
-    pthread_mutex_t timer_lock;
+    uint64_t wake;
+    uint32_t release;
+} __attribute__ ((aligned (TIMER_CACHE_LINE)));
+
+/**
+ * @brief
+ *      An event of the timing wheel: `fn (arg)` is called at the boundary of
+ * slot `expires`, before any device runs in that slot.
+ *
+ *  next, prev : links in the bucket, NULL when not pending.
+ */
+struct timer_event_t
+{
+    uint64_t expires;
+    void (*fn) (void *arg);
+    void *arg;
+    struct timer_event_t *next;
+    struct timer_event_t *prev;
 };
 
+/**
+ * @brief
+ *      Arm `event` to fire at slot `slot`, O(1). A slot which has already
+ * begun means the next boundary. Events armed in the same slot for the same
+ * slot fire in the order they were armed. A callback may arm or cancel
+ * events.
+ */
+void schedule_event (struct timer_event_t *event, uint64_t slot,
+                     void (*fn) (void *), void *arg);
+
+/* Disarm `event` if it is pending, O(1) */
+void cancel_event (struct timer_event_t *event);
+
 void start_timer ();
 
+/**
+ * @brief
+ *      Wait for the timer to end, once every device has detached, devices
+ * attached while it was running included.
+ */
 void stop_timer ();
 
+/**
+ * @brief
+ *      Attach a device before start_timer(), or at a slot boundary, i.e.
+ * from an event callback, to bring a device in while the timer is running.
+ * The device of a detached one is then reused.
+ *
+ * @return NULL if there are TIMER_MAX_DEVICES already.
+ */
 struct timer_id_t *attach_event ();
 
+/**
+ * @brief
+ *      First call of a device: wait for its first slot, slot 0 for a device
+ * attached before start_timer(), else the one beginning at the boundary it
+ * was attached at.
+ */
+void join_slot (struct timer_id_t *timer_id);
+
 void detach_event (struct timer_id_t *event);
 
 void next_slot (struct timer_id_t *timer_id);
 
+/**
+ * @brief
+ *      Like next_slot(), for a device with nothing to do: it resumes at the
+ * next slot in which another device runs.
+ */
+void idle_slot (struct timer_id_t *timer_id);
+
+/**
+ * @brief
+ *      Like next_slot(), but resume only at slot `slot`. The timer does not
+ * handshake with a sleeping device, and when every device is idle or
+ * asleep, it jumps straight to the earliest wake-up slot.
+ */
+void sleep_until (struct timer_id_t *timer_id, uint64_t slot);
+
 uint64_t current_time ();
 
+/**
+ * @brief
+ *      Begin slot 0 and fire its events. start_timer() does it, the
+ * single-threaded engine calls it instead.
+ */
+void start_clock ();
+
+/**
+ * @brief
+ *      Move to the next slot by hand, for the single-threaded engine which
+ * runs without the timer thread, and fire its events. When `idle`, nothing
+ * runs until the next event, so the clock jumps to it. Never call it while
+ * the timer is running.
+ */
+void step_time (int idle);
+
 #endif
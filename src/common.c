@@ -1,4 +1,5 @@
 #include "common.h"
+#include "log.h"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -17,7 +18,12 @@ create_pcb (uint32_t pid, uint32_t priority, struct code_seg_t *code,
         = (struct page_table_t *)malloc (sizeof (struct page_table_t));
     retpcb->bp = bp;
     retpcb->pc = 0;
+    retpcb->counter = 0;
     retpcb->prio = -1;
+    retpcb->vruntime = 0;
+    retpcb->deadline = 0;
+    retpcb->edf_util = 0;
+    retpcb->last_cpu = -1;
 
     return retpcb;
 }
@@ -32,14 +38,11 @@ destroy_pcb (struct pcb_t *ptr)
 void
 dump_register (struct pcb_t *ptr)
 {
-    flockfile (stdout); // To avoid the dump messages
-                        // interleaved by external messages
-    printf ("=== Process's register dump ===\n");
-    printf("Process %d:\n", ptr->pid);
+    log_printf (LOG_INFO, "=== Process's register dump ===\n");
+    log_printf (LOG_INFO, "Process %d:\n", ptr->pid);
     for (int i = 0 ; i < 10 ; ++i)
     {
-        printf("reg %d: %4d\n", i, ptr->regs[i]);
+        log_printf (LOG_INFO, "reg %d: %4d\n", i, ptr->regs[i]);
     }
-    printf ("===============================\n");
-    funlockfile (stdout); // Follows the above flockfile()
+    log_printf (LOG_INFO, "===============================\n");
 }
\ No newline at end of file
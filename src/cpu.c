@@ -10,9 +10,13 @@
 #include "cpu.h"
 #include "mem.h"
 #include "mm.h"
+#include "log.h"
 #include <stdlib.h>
 #include <stdio.h>
 
+/* Past the opcodes: the handler table ends with the one of unknown ones */
+#define OP_UNKNOWN (JNZ + 1)
+
 /**
  *      Always return 0
  *
@@ -110,73 +114,215 @@ write (struct pcb_t *proc,   // Process executing the instruction
 #endif // ALLOW_DEPRECATED
 
 /**
- *      Execute AN instruction in the process and increase the program counter
- *      by one. This func does NOT execute all instructions at once.
+ *      The dispatch loop: run the pre-decoded instructions of `proc` from
+ *      its program counter, `budget` of them at most. Each handler ends by
+ *      jumping straight to the handler of the next instruction, there is no
+ *      switch to go back to. Called with `proc` NULL, it only gives decode()
+ *      the table of its handlers, by opcode.
  *
  * @return
- *      0 if successful,
- *      1 if no more instructions,
+ *      the number of instructions executed,
  *      ABORT if abnormal error.
  */
-int
-run (struct pcb_t *proc)
+static int
+interp (struct pcb_t *proc, int budget, const void *const **table)
 {
-    /* Check if the Program Counter points to the proper instruction */
-    if (proc->pc >= proc->code->size)
+    static const void *const handlers[] = {
+        [CALC] = &&do_calc,   [ALLOC] = &&do_alloc, [FREE] = &&do_free,
+        [READ] = &&do_read,   [WRITE] = &&do_write, [LOOP] = &&do_loop,
+        [JMP] = &&do_jmp,     [JNZ] = &&do_jnz,     [OP_UNKNOWN] = &&do_skip,
+    };
+    struct op_t *ops, *op, *end, *stop;
+    int left = budget; // instructions left to run
+    int stat, n;
+#ifdef MM_PAGING
+    int addr;
+#endif
+
+    if (__builtin_expect (proc == NULL, 0))
         {
-            return 1;
+            *table = handlers;
+            return 0;
         }
+    if (__builtin_expect (proc->code->ops == NULL, 0))
+        decode (proc->code);
+    ops = proc->code->ops;
+    op = ops + proc->pc;
+    end = ops + proc->code->size;
 
-    struct inst_t ins = proc->code->text[proc->pc];
-    proc->pc++; // Increase the program counter
-    int stat = 1;
-    switch (ins.opcode)
-        {
-        case CALC:
-            stat = calc (proc);
-            break;
-        case ALLOC:
-#ifdef MM_PAGING
-            stat = pgalloc (proc, ins.arg_0, ins.arg_1);
+/* Go to the next instruction, or out of the loop */
+#define DISPATCH()                                                            \
+    do                                                                        \
+        {                                                                     \
+            if (left == 0 || op == end)                                       \
+                goto out;                                                     \
+            goto *op->handler;                                                \
+        }                                                                     \
+    while (0)
+/* End of a handler: abort on a fault, then go on */
+#define NEXT()                                                                \
+    do                                                                        \
+        {                                                                     \
+            if (stat == -1)                                                   \
+                goto fault;                                                   \
+            op++;                                                             \
+            left--;                                                           \
+            DISPATCH ();                                                      \
+        }                                                                     \
+    while (0)
+/* Take the run of fused instructions at `op` out of the budget, as many
+ * of them as it allows */
+#define TAKE_RUN()                                                            \
+    do                                                                        \
+        {                                                                     \
+            n = (uint32_t)left < op->run ? left : (int)op->run;               \
+            left -= n;                                                        \
+        }                                                                     \
+    while (0)
 
+    DISPATCH ();
+do_calc: // calc() does nothing, a run of them is done at once
+    stat = calc (proc);
+    TAKE_RUN ();
+    op += n;
+    DISPATCH ();
+do_alloc:
+#ifdef MM_PAGING
+    stat = __alloc (proc, 0, op->arg_1, op->arg_0, &addr);
 #else
-            stat = alloc (proc, ins.arg_0, ins.arg_1);
+    stat = alloc (proc, op->arg_0, op->arg_1);
 #endif
-            break;
-        case FREE:
+    NEXT ();
+do_free:
 #ifdef MM_PAGING
-            stat = pgfree_data (proc, ins.arg_0);
+    stat = __free (proc, 0, op->arg_0);
 #else
-            stat = free_data (proc, ins.arg_0);
+    stat = free_data (proc, op->arg_0);
 #endif
-            break;
-        case READ:
+    NEXT ();
+do_read:
+    TAKE_RUN ();
+    for (stop = op + n; op < stop; op++)
+        {
 #ifdef MM_PAGING
-            stat = pgread (proc, ins.arg_0, ins.arg_1, ins.arg_2);
+            stat = pgread (proc, op->arg_0, op->arg_1, op->arg_2);
 #else
-            stat = read (proc, ins.arg_0, ins.arg_1, ins.arg_2);
+            stat = read (proc, op->arg_0, op->arg_1, op->arg_2);
 #endif
-            break;
-        case WRITE:
+            if (stat == -1)
+                goto fault;
+        }
+    DISPATCH ();
+do_write:
+    TAKE_RUN ();
+    for (stop = op + n; op < stop; op++)
+        {
 #ifdef MM_PAGING
-            stat = pgwrite (proc, ins.arg_0, ins.arg_1, ins.arg_2);
+            /* The dumps around a write are pgwrite()'s, skip it without
+             * them */
+            if (log_enabled (LOG_IO))
+                stat = pgwrite (proc, op->arg_0, op->arg_1, op->arg_2);
+            else
+                stat = __write (proc, 0, op->arg_1, op->arg_2, op->arg_0);
 #else
-            stat = write (proc, ins.arg_0, ins.arg_1, ins.arg_2);
+            stat = write (proc, op->arg_0, op->arg_1, op->arg_2);
 #endif
-            break;
-        default:
-            stat = 1;
+            if (stat == -1)
+                goto fault;
         }
+    DISPATCH ();
+do_loop:
+    proc->counter = op->arg_0;
+    op++;
+    left--;
+    DISPATCH ();
+do_jmp:
+    op = ops + op->arg_0;
+    left--;
+    DISPATCH ();
+do_jnz: // decrement the counter, and jump while it is not zero
+    if (proc->counter != 0 && --proc->counter != 0)
+        op = ops + op->arg_0;
+    else
+        op++;
+    left--;
+    DISPATCH ();
+do_skip: // an unknown opcode does nothing
+    op++;
+    left--;
+    DISPATCH ();
+#undef TAKE_RUN
+#undef NEXT
+#undef DISPATCH
+
+out:
+    proc->pc = op - ops;
+    return budget - left;
+
+fault: // If an instruction does not execute as expected, the program aborts
+    proc->pc = op - ops + 1;
+    log_printf (LOG_ERROR, "\n\n");
+    log_printf (LOG_ERROR, "ABORT: in cpu.c, run(). Instruction "
+                           "did not execute as expected.\n");
+    exit (0);
+}
 
-    if (stat == -1) // Handle instruction fault.
-                    // If an instruction does not execute
-                    // as expected, the program aborts
+void
+decode (struct code_seg_t *code)
+{
+    const void *const *handlers;
+    uint32_t i;
 
+    interp (NULL, 0, &handlers);
+    code->ops = (struct op_t *)malloc (sizeof (struct op_t) * code->size);
+    if (code->ops == NULL)
         {
-            printf("\n\n");
-            printf ("ABORT: in cpu.c, run(). Instruction did not execute as "
-                    "expected.\n");
-            exit(0);
+            printf ("Error: in cpu.c / decode() :\n");
+            printf ("Can not allocate the decoded code.\n");
+            exit (1);
+        }
+    for (i = 0; i < code->size; i++)
+        {
+            struct inst_t *ins = &code->text[i];
+            struct op_t *op = &code->ops[i];
+
+            op->handler = handlers[(unsigned)ins->opcode < OP_UNKNOWN
+                                       ? ins->opcode
+                                       : OP_UNKNOWN];
+            op->arg_0 = ins->arg_0;
+            op->arg_1 = ins->arg_1;
+            op->arg_2 = ins->arg_2;
+            op->run = 1;
+            if (ins->opcode == WRITE)
+                op->arg_0 = (BYTE)ins->arg_0; // the data written
+            if ((ins->opcode == JMP || ins->opcode == JNZ)
+                && ins->arg_0 > code->size)
+                op->arg_0 = code->size; // out of the code, it ends there
+        }
+}
+
+int
+run_ops (struct pcb_t *proc, int budget)
+{
+    return interp (proc, budget, NULL);
+}
+
+/**
+ *      Execute AN instruction in the process and increase the program counter
+ *      by one. This func does NOT execute all instructions at once.
+ *
+ * @return
+ *      0 if successful,
+ *      1 if no more instructions,
+ *      ABORT if abnormal error.
+ */
+int
+run (struct pcb_t *proc)
+{
+    /* Check if the Program Counter points to the proper instruction */
+    if (proc->pc >= proc->code->size)
+        {
+            return 1;
         }
-    return stat;
+    return interp (proc, 1, NULL) == 1 ? 0 : 1;
 }
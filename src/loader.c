@@ -5,6 +5,7 @@
  * 
  */
 #include "loader.h"
+#include "cpu.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,13 +17,16 @@ static uint32_t avail_pid = 1;
 #define OPT_FREE "free"
 #define OPT_READ "read"
 #define OPT_WRITE "write"
+#define OPT_LOOP "loop"
+#define OPT_JMP "jmp"
+#define OPT_JNZ "jnz"
 
 /**
  * @brief
  *      Cast optcode string to optcode enum
  * 
  * @return
- *      enum CALC or ALLOC or FREE or READ or WRITE
+ *      enum CALC or ALLOC or FREE or READ or WRITE or LOOP or JMP or JNZ
  */
 static enum ins_opcode_t
 get_opcode (char *opt)
@@ -47,6 +51,18 @@ get_opcode (char *opt)
         {
             return WRITE;
         }
+    else if (!strcmp (opt, OPT_LOOP))
+        {
+            return LOOP;
+        }
+    else if (!strcmp (opt, OPT_JMP))
+        {
+            return JMP;
+        }
+    else if (!strcmp (opt, OPT_JNZ))
+        {
+            return JNZ;
+        }
     else
         {
             printf ("Opcode: %s\n", opt);
@@ -54,6 +70,48 @@ get_opcode (char *opt)
         }
 }
 
+/* Whether `next` may run in the same dispatch as `ins` */
+static int
+fusable (const struct inst_t *ins, const struct inst_t *next)
+{
+    if (ins->opcode != next->opcode)
+        return 0;
+    switch (ins->opcode)
+        {
+        case CALC:
+            return 1;
+        case READ:
+            return ins->arg_0 == next->arg_0; // from the same region
+        case WRITE:
+            return ins->arg_1 == next->arg_1; // to the same region
+        default:
+            return 0;
+        }
+}
+
+/**
+ * @brief
+ *      Fuse the decoded instructions of `code`: a run of CALCs, or of READs
+ * or WRITEs to the same region, is run by a single dispatch. Each of its
+ * instructions knows how many are left in the run, so that a slot may end
+ * anywhere inside, and each still counts as one instruction.
+ */
+static void
+fuse (struct code_seg_t *code)
+{
+    uint32_t i, run = 0;
+
+    for (i = code->size; i-- > 0;)
+        {
+            if (i + 1 < code->size
+                && fusable (&code->text[i], &code->text[i + 1]))
+                run++;
+            else
+                run = 1;
+            code->ops[i].run = run;
+        }
+}
+
 /**
  * @brief
  *      Read processes from an external file, and assign properties to it.
@@ -72,6 +130,13 @@ load (const char *path)
         = (struct page_table_t *)malloc (sizeof (struct page_table_t));
     proc->bp = PAGE_SIZE;
     proc->pc = 0;
+    proc->counter = 0;
+    proc->last_cpu = -1;
+#ifdef MLQ_SCHED
+    proc->vruntime = 0;
+    proc->deadline = 0;
+    proc->edf_util = 0;
+#endif
 
     /* Read process code from file */
     FILE *file;
@@ -101,6 +166,21 @@ load (const char *path)
                 case FREE:
                     fscanf (file, "%u\n", &proc->code->text[i].arg_0);
                     break;
+                case LOOP:
+                    fscanf (file, "%u\n", &proc->code->text[i].arg_0);
+                    break;
+                case JMP:
+                case JNZ:
+                    /* The index of the target instruction, from 0 */
+                    fscanf (file, "%u\n", &proc->code->text[i].arg_0);
+                    if (proc->code->text[i].arg_0 >= proc->code->size)
+                        {
+                            printf ("Jump out of the code at '%s': %s %u\n",
+                                    path, opcode,
+                                    proc->code->text[i].arg_0);
+                            exit (1);
+                        }
+                    break;
                 case READ:
                 case WRITE:
                     fscanf (file, "%u %u %u\n", &proc->code->text[i].arg_0,
@@ -112,5 +192,7 @@ load (const char *path)
                     exit (1);
                 }
         }
+    decode (proc->code);
+    fuse (proc->code);
     return proc;
 }
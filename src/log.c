@@ -0,0 +1,330 @@
+/**
+ * @file log.c
+ * @category Implementation source code
+ * @brief
+ *      Implementation from `log.h` interface.
+ *
+ *      The queue of a thread is a list of chunks, with one producer, the
+ * thread, and one consumer, the flusher. The producer fills the tail chunk
+ * and publishes each line by bumping its `count`; a full chunk gets a new
+ * one linked after it, so that logging never waits for the flusher, even
+ * when a slot is longer than a chunk. The flusher frees the chunks it has
+ * read through.
+ */
+#include "log.h"
+#include "os-cfg.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct log_line_t
+{
+    uint64_t slot;
+    int len;
+    char text[LOG_LINE_MAX];
+};
+
+struct log_chunk_t
+{
+    struct log_chunk_t *next;
+    uint32_t count; // lines published
+    struct log_line_t lines[LOG_CHUNK_LINES];
+};
+
+/**
+ * @brief
+ *      Queue of one thread.
+ *
+ *  tail       : chunk the thread writes to, owned by the thread.
+ *  head, read : chunk and line the flusher reads next, owned by it.
+ *  next       : next queue, in source order.
+ */
+struct log_queue_t
+{
+    int source;
+    struct log_chunk_t *tail;
+    struct log_chunk_t *head;
+    uint32_t read;
+    struct log_queue_t *next;
+};
+
+static int log_level = LOG_DEFAULT_LEVEL;
+static int log_running = 0;
+static uint64_t log_slot = 0;     // lines of earlier slots are complete
+static uint64_t log_written = 0; // slots written out so far
+
+/* The list of queues, and the sleep of the flusher */
+static struct log_queue_t *log_queues = NULL;
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_cond = PTHREAD_COND_INITIALIZER;
+static int log_sleeping = 0;
+static int log_stop = 0;
+static pthread_t log_flusher;
+
+/* Queues of the calling thread, one per source it has logged for */
+static __thread struct log_queue_t **my_queues = NULL;
+static __thread int my_nr_queues = 0;
+static __thread int my_source = 0;
+
+static struct log_chunk_t *
+log_new_chunk (void)
+{
+    struct log_chunk_t *chunk = calloc (1, sizeof (struct log_chunk_t));
+
+    if (chunk == NULL)
+        {
+            printf ("Error: in log.c / log_new_chunk() :\n");
+            printf ("Can not allocate a log chunk.\n");
+            exit (1);
+        }
+    return chunk;
+}
+
+/* Queue of the calling thread for its source, linked in source order at
+ * its first line */
+static struct log_queue_t *
+log_queue (void)
+{
+    struct log_queue_t *queue, **pos;
+
+    if (my_source < my_nr_queues && my_queues[my_source] != NULL)
+        return my_queues[my_source];
+
+    if (my_source >= my_nr_queues)
+        {
+            pos = realloc (my_queues,
+                           sizeof (struct log_queue_t *) * (my_source + 1));
+            if (pos == NULL)
+                {
+                    printf ("Error: in log.c / log_queue() :\n");
+                    printf ("Can not grow the log queues of a thread.\n");
+                    exit (1);
+                }
+            while (my_nr_queues <= my_source)
+                pos[my_nr_queues++] = NULL;
+            my_queues = pos;
+        }
+    queue = calloc (1, sizeof (struct log_queue_t));
+    if (queue == NULL)
+        {
+            printf ("Error: in log.c / log_queue() :\n");
+            printf ("Can not allocate a log queue.\n");
+            exit (1);
+        }
+    my_queues[my_source] = queue;
+    queue->source = my_source;
+    queue->tail = queue->head = log_new_chunk ();
+
+    pthread_mutex_lock (&log_lock);
+    for (pos = &log_queues; *pos != NULL && (*pos)->source <= my_source;
+         pos = &(*pos)->next)
+        ;
+    queue->next = *pos;
+    *pos = queue;
+    pthread_mutex_unlock (&log_lock);
+    return queue;
+}
+
+/* Next line of `queue` for the flusher, NULL if none is published yet */
+static struct log_line_t *
+log_peek (struct log_queue_t *queue)
+{
+    struct log_chunk_t *chunk = queue->head;
+
+    if (queue->read == LOG_CHUNK_LINES)
+        {
+            struct log_chunk_t *next
+                = __atomic_load_n (&chunk->next, __ATOMIC_ACQUIRE);
+            if (next == NULL)
+                return NULL;
+            free (chunk); // the thread has moved on to `next`
+            queue->head = chunk = next;
+            queue->read = 0;
+        }
+    if (queue->read < __atomic_load_n (&chunk->count, __ATOMIC_ACQUIRE))
+        return &chunk->lines[queue->read];
+    return NULL;
+}
+
+/**
+ * @brief
+ *      Write out the lines of the slots before `upto`: the earliest slot
+ * first, and within a slot, queue after queue in source order.
+ */
+static void
+log_drain (uint64_t upto)
+{
+    struct log_queue_t *queue;
+    struct log_line_t *line;
+
+    pthread_mutex_lock (&log_lock);
+    while (1)
+        {
+            uint64_t slot = UINT64_MAX;
+
+            for (queue = log_queues; queue != NULL; queue = queue->next)
+                if ((line = log_peek (queue)) != NULL && line->slot < slot)
+                    slot = line->slot;
+            if (slot >= upto)
+                break;
+            for (queue = log_queues; queue != NULL; queue = queue->next)
+                while ((line = log_peek (queue)) != NULL && line->slot == slot)
+                    {
+                        fwrite (line->text, 1, line->len, stdout);
+                        queue->read++;
+                    }
+        }
+    pthread_mutex_unlock (&log_lock);
+    fflush (stdout);
+}
+
+static void *
+log_routine (void *args)
+{
+    uint64_t slot;
+
+    pthread_mutex_lock (&log_lock);
+    while (!log_stop)
+        {
+            __atomic_store_n (&log_sleeping, 1, __ATOMIC_SEQ_CST);
+            /* Pairs with log_set_slot(): either it sees us asleep, or we
+             * see the slot it has set */
+            slot = __atomic_load_n (&log_slot, __ATOMIC_SEQ_CST);
+            if (slot < __atomic_load_n (&log_written, __ATOMIC_RELAXED)
+                           + LOG_FLUSH_SLOTS)
+                pthread_cond_wait (&log_cond, &log_lock);
+            __atomic_store_n (&log_sleeping, 0, __ATOMIC_RELAXED);
+
+            slot = __atomic_load_n (&log_slot, __ATOMIC_ACQUIRE);
+            pthread_mutex_unlock (&log_lock);
+            log_drain (slot);
+            __atomic_store_n (&log_written, slot, __ATOMIC_RELAXED);
+            pthread_mutex_lock (&log_lock);
+        }
+    pthread_mutex_unlock (&log_lock);
+    return args;
+}
+
+void
+log_init (void)
+{
+    static int registered = 0;
+
+    if (log_running)
+        return;
+    log_stop = 0;
+    log_written = __atomic_load_n (&log_slot, __ATOMIC_RELAXED);
+    log_running = 1;
+    pthread_create (&log_flusher, NULL, log_routine, NULL);
+    if (!registered)
+        {
+            atexit (log_finish);
+            registered = 1;
+        }
+}
+
+/**
+ * @note
+ *      The queues are kept, a thread still running at exit() may hold one.
+ */
+void
+log_finish (void)
+{
+    if (!log_running)
+        return;
+    pthread_mutex_lock (&log_lock);
+    log_stop = 1;
+    pthread_cond_signal (&log_cond);
+    pthread_mutex_unlock (&log_lock);
+    pthread_join (log_flusher, NULL);
+
+    log_drain (UINT64_MAX);
+    log_running = 0;
+}
+
+void
+log_set_level (int level)
+{
+    log_level = level;
+}
+
+int
+log_parse_level (const char *name)
+{
+    static const char *names[] = { "error", "info", "io", "dump" };
+    int level;
+
+    for (level = LOG_ERROR; level <= LOG_DUMP; level++)
+        if (!strcmp (name, names[level]))
+            return level;
+    if (sscanf (name, "%d", &level) == 1 && level >= LOG_ERROR
+        && level <= LOG_DUMP)
+        return level;
+    return -1;
+}
+
+int
+log_enabled (int level)
+{
+    return level <= log_level;
+}
+
+void
+log_set_source (int source)
+{
+    my_source = source;
+}
+
+void
+log_set_slot (uint64_t slot)
+{
+    __atomic_store_n (&log_slot, slot, __ATOMIC_SEQ_CST);
+    if (slot >= __atomic_load_n (&log_written, __ATOMIC_RELAXED)
+                    + LOG_FLUSH_SLOTS
+        && __atomic_load_n (&log_sleeping, __ATOMIC_SEQ_CST))
+        {
+            pthread_mutex_lock (&log_lock);
+            pthread_cond_signal (&log_cond);
+            pthread_mutex_unlock (&log_lock);
+        }
+}
+
+void
+log_printf (int level, const char *fmt, ...)
+{
+    struct log_queue_t *queue;
+    struct log_chunk_t *chunk;
+    struct log_line_t *line;
+    uint32_t n;
+    va_list ap;
+    int len;
+
+    if (level > log_level)
+        return;
+    va_start (ap, fmt);
+    if (!log_running)
+        {
+            vprintf (fmt, ap);
+            va_end (ap);
+            return;
+        }
+
+    queue = log_queue ();
+    chunk = queue->tail;
+    n = chunk->count;
+    if (n == LOG_CHUNK_LINES)
+        {
+            struct log_chunk_t *next = log_new_chunk ();
+            __atomic_store_n (&chunk->next, next, __ATOMIC_RELEASE);
+            queue->tail = chunk = next;
+            n = 0;
+        }
+    line = &chunk->lines[n];
+    line->slot = __atomic_load_n (&log_slot, __ATOMIC_ACQUIRE);
+    len = vsnprintf (line->text, LOG_LINE_MAX, fmt, ap);
+    va_end (ap);
+    line->len = len < 0 ? 0 : len < LOG_LINE_MAX ? len : LOG_LINE_MAX - 1;
+    __atomic_store_n (&chunk->count, n + 1, __ATOMIC_RELEASE);
+}
@@ -13,6 +13,7 @@
  */
 
 #include "mm.h"
+#include "log.h"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -250,10 +251,8 @@ MEMPHY_dump (struct memphy_struct *mp)
     /*TODO dump memphy contnt mp->storage
      *     for tracing the memory content
      */
-    flockfile (stdout); // To avoid the dump messages
-                        // interleaved by external messages
-    printf ("=== Physical Memory Dump ===\n");
-    printf ("%7s  %10s:%7s\n", "fpn", "phyaddr", "value");
+    log_printf (LOG_INFO, "=== Physical Memory Dump ===\n");
+    log_printf (LOG_INFO, "%7s  %10s:%7s\n", "fpn", "phyaddr", "value");
     for (int phyaddr = 0; phyaddr < mp->maxsz; phyaddr++)
         {
             // int fpn = -1;
@@ -263,11 +262,10 @@ MEMPHY_dump (struct memphy_struct *mp)
             int fpn = phyaddr >> PAGING_ADDR_FPN_LOBIT;
 
             if (mp->storage[phyaddr] != '\0') // if that position is clean
-                printf ("%7d  %010d:%7d\n", fpn, phyaddr,
-                        mp->storage[phyaddr]);
+                log_printf (LOG_INFO, "%7d  %010d:%7d\n", fpn, phyaddr,
+                            mp->storage[phyaddr]);
         }
-    printf ("============================\n");
-    funlockfile (stdout); // Follows the above flockfile()
+    log_printf (LOG_INFO, "============================\n");
     return 0;
 }
 
@@ -12,6 +12,7 @@
  */
 
 #include "mm.h"
+#include "log.h"
 #include "string.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -103,8 +104,8 @@ __alloc (struct pcb_t *caller, int vmaid, int rgid, int size, int *alloc_addr)
 
             *alloc_addr = rgnode.rg_start;
 
-            printf ("alloc region=%d, size=%d, pid=%d\n", rgid, size,
-                    caller->pid);
+            log_printf (LOG_INFO, "alloc region=%d, size=%d, pid=%d\n", rgid,
+                        size, caller->pid);
 
             return 0;
         }
@@ -114,8 +115,8 @@ __alloc (struct pcb_t *caller, int vmaid, int rgid, int size, int *alloc_addr)
     struct vm_area_struct *cur_vma = get_vma_by_num (caller->mm, vmaid);
     if (cur_vma == NULL)
         {
-            printf ("Error: in mm-vm.c / __alloc() :\n");
-            printf ("Can not get current vma.\n");
+            log_printf (LOG_ERROR, "Error: in mm-vm.c / __alloc() :\n");
+            log_printf (LOG_ERROR, "Can not get current vma.\n");
         }
     // find gap between sbrk and vm_end
     // if large enough, fit in without any additional work
@@ -131,8 +132,8 @@ __alloc (struct pcb_t *caller, int vmaid, int rgid, int size, int *alloc_addr)
             caller->mm->symrgtbl[rgid].rg_start = old_sbrk;
             caller->mm->symrgtbl[rgid].rg_end = old_sbrk + size;
 
-            printf ("alloc region=%d, size=%d, pid=%d\n", rgid, size,
-                    caller->pid);
+            log_printf (LOG_INFO, "alloc region=%d, size=%d, pid=%d\n", rgid,
+                        size, caller->pid);
             return 0;
         }
     // otherwise, we need to fit in one page at a time
@@ -146,8 +147,9 @@ __alloc (struct pcb_t *caller, int vmaid, int rgid, int size, int *alloc_addr)
     /* INCREASE THE LIMIT */
     if (inc_vma_limit (caller, vmaid, inc_sz) != 0)
         {
-            printf ("Error: in mm-vm.c / __alloc() :\n");
-            printf ("inc_vma_limit() can not increase the limit.\n");
+            log_printf (LOG_ERROR, "Error: in mm-vm.c / __alloc() :\n");
+            log_printf (LOG_ERROR,
+                        "inc_vma_limit() can not increase the limit.\n");
             return -1;
         }
 
@@ -159,7 +161,8 @@ __alloc (struct pcb_t *caller, int vmaid, int rgid, int size, int *alloc_addr)
     caller->mm->symrgtbl[rgid].rg_end = old_sbrk + size;
 
     *alloc_addr = old_sbrk;
-    printf ("alloc region=%d, size=%d, pid=%d\n", rgid, size, caller->pid);
+    log_printf (LOG_INFO, "alloc region=%d, size=%d, pid=%d\n", rgid, size,
+                caller->pid);
     return 0;
 }
 
@@ -184,9 +187,10 @@ __free (struct pcb_t *caller, int vmaid, int rgid)
     if (currg == NULL || cur_vma == NULL
         || (currg->rg_start == currg->rg_end)) /* Invalid memory identify */
         {
-            printf ("Error: in mm-vm.c / __free() :\n");
-            printf ("Segmentation fault. Can not get region %d OR vma %d.\n",
-                    rgid, vmaid);
+            log_printf (LOG_ERROR, "Error: in mm-vm.c / __free() :\n");
+            log_printf (LOG_ERROR,
+                        "Segmentation fault. Can not get region %d OR vma %d.\n",
+                        rgid, vmaid);
             return -1;
         }
 
@@ -211,9 +215,9 @@ __free (struct pcb_t *caller, int vmaid, int rgid)
     /* enlist the obsoleted memory region */
     if (enlist_vm_freerg_list (caller->mm, free_rg) != 0)
         {
-            printf ("Error: in mm-vm.c / __free() :\n");
-            printf (
-                "Can not enlist the current region into vm_freerg_list.\n");
+            log_printf (LOG_ERROR, "Error: in mm-vm.c / __free() :\n");
+            log_printf (LOG_ERROR,
+                        "Can not enlist the current region into vm_freerg_list.\n");
             return -1;
         }
 
@@ -224,7 +228,7 @@ __free (struct pcb_t *caller, int vmaid, int rgid)
      * issued) will print them out regardless of they have been freed using
      * this func.
      */
-    printf ("free region=%d, pid=%d\n", rgid, caller->pid);
+    log_printf (LOG_INFO, "free region=%d, pid=%d\n", rgid, caller->pid);
     return 0;
 }
 
@@ -296,14 +300,16 @@ pg_getpage (struct mm_struct *mm, int pgn, int *fpn, struct pcb_t *caller)
             if (get_freefp_status != -1)
                 {
                     pte_set_fpn (&pte, freefpn);
-                    printf ("Get free frame from RAM succesfully.\n");
+                    log_printf (LOG_INFO,
+                                "Get free frame from RAM succesfully.\n");
                 }
             else
                 {
                     int vicpgn;
                     if (find_victim_page (caller->mm, &vicpgn) == -1)
                         {
-                            printf ("Get find victim page failed.\n");
+                            log_printf (LOG_ERROR,
+                                        "Get find victim page failed.\n");
                             return -1;
                         }
 
@@ -370,8 +376,9 @@ pg_getpage (struct mm_struct *mm, int pgn, int *fpn, struct pcb_t *caller)
                     mm->pgd[vicpgn] = vicpte; // Update page table
                     mm->pgd[pgn] = pte;       // Update page table
 
-                    printf ("Swapped sucessfully, frame %d updated.\n",
-                            dstfpn_in);
+                    log_printf (LOG_INFO,
+                                "Swapped sucessfully, frame %d updated.\n",
+                                dstfpn_in);
                 }
 
             /* Do swap frame from MEMRAM to MEMSWP and vice versa*/
@@ -412,8 +419,8 @@ pg_getval (struct mm_struct *mm, int addr, BYTE *data, struct pcb_t *caller)
     /* Get the page to MEMRAM, swap from MEMSWAP if needed */
     if (pg_getpage (mm, pgn, &fpn, caller) != 0)
         {
-            printf ("Error: in mm-vm.c / pg_getval() :\n");
-            printf ("pg_getpage() is not sucessful.\n");
+            log_printf (LOG_ERROR, "Error: in mm-vm.c / pg_getval() :\n");
+            log_printf (LOG_ERROR, "pg_getpage() is not sucessful.\n");
             return -1; /* invalid page access */
         }
 
@@ -421,8 +428,8 @@ pg_getval (struct mm_struct *mm, int addr, BYTE *data, struct pcb_t *caller)
 
     if (MEMPHY_read (caller->mram, phyaddr, data) != 0)
         {
-            printf ("Error: in mm-vm.c / pg_getval() :\n");
-            printf ("MEMPHY_read() error.\n");
+            log_printf (LOG_ERROR, "Error: in mm-vm.c / pg_getval() :\n");
+            log_printf (LOG_ERROR, "MEMPHY_read() error.\n");
             return -1;
         }
 
@@ -445,8 +452,8 @@ pg_setval (struct mm_struct *mm, int addr, BYTE value, struct pcb_t *caller)
     /* Get the page to MEMRAM, swap from MEMSWAP if needed */
     if (pg_getpage (mm, pgn, &fpn, caller) != 0)
         {
-            printf ("Error: in mm-vm.c / pg_setval() :\n");
-            printf ("pg_getpage() is not sucessful.\n");
+            log_printf (LOG_ERROR, "Error: in mm-vm.c / pg_setval() :\n");
+            log_printf (LOG_ERROR, "pg_getpage() is not sucessful.\n");
             return -1; /* invalid page access */
         }
 
@@ -454,8 +461,8 @@ pg_setval (struct mm_struct *mm, int addr, BYTE value, struct pcb_t *caller)
 
     if (MEMPHY_write (caller->mram, phyaddr, value) != 0)
         {
-            printf ("Error: in mm-vm.c / pg_setval() :\n");
-            printf ("MEMPHY_write() error.\n");
+            log_printf (LOG_ERROR, "Error: in mm-vm.c / pg_setval() :\n");
+            log_printf (LOG_ERROR, "MEMPHY_write() error.\n");
             return -1;
         }
 
@@ -480,17 +487,19 @@ __read (struct pcb_t *caller, int vmaid, int rgid, int offset, BYTE *data)
     if (currg == NULL || cur_vma == NULL
         || (currg->rg_start == currg->rg_end)) /* Invalid memory identify */
         {
-            printf ("Error: in mm-vm.c / __read() :\n");
-            printf ("Segmentation fault. Can not get region %d OR vma %d.\n",
-                    rgid, vmaid);
+            log_printf (LOG_ERROR, "Error: in mm-vm.c / __read() :\n");
+            log_printf (LOG_ERROR,
+                        "Segmentation fault. Can not get region %d OR vma %d.\n",
+                        rgid, vmaid);
             return -1;
         }
 
     if (currg->rg_start + offset < currg->rg_start
         || currg->rg_start + offset > currg->rg_end)
         {
-            printf ("Error: in mm-vm.c / __read() :\n");
-            printf ("Segmentation fault. Accessing out-of-range region.\n");
+            log_printf (LOG_ERROR, "Error: in mm-vm.c / __read() :\n");
+            log_printf (LOG_ERROR,
+                        "Segmentation fault. Accessing out-of-range region.\n");
             return -1;
         }
 
@@ -528,18 +537,18 @@ pgread (struct pcb_t *proc, // Process executing the instruction
     
     if (pgwrite(proc, data, destination, 0) != 0)
     {
-        printf ("Error: in mm-vm.c / pgread() :\n");
-        printf("Storing the read value failed.\n");
+        log_printf (LOG_ERROR, "Error: in mm-vm.c / pgread() :\n");
+        log_printf (LOG_ERROR, "Storing the read value failed.\n");
     }
     // proc->regs[destination] = data;
-#ifdef IODUMP
-    printf ("read region=%d offset=%d value=%d, pid=%d\n", source, offset,
-            data, proc->pid);
-#ifdef PAGETBL_DUMP
-    print_pgtbl (proc, 0, -1); // print max TBL
-#endif
-    MEMPHY_dump (proc->mram);
-#endif
+    if (log_enabled (LOG_IO))
+        {
+            log_printf (LOG_IO, "read region=%d offset=%d value=%d, pid=%d\n",
+                        source, offset, data, proc->pid);
+            if (log_enabled (LOG_DUMP))
+                print_pgtbl (proc, 0, -1); // print max TBL
+            MEMPHY_dump (proc->mram);
+        }
 
     // Dump register after READ
     // dump_register (proc);
@@ -562,17 +571,19 @@ __write (struct pcb_t *caller, int vmaid, int rgid, int offset, BYTE value)
     if (currg == NULL || cur_vma == NULL
         || (currg->rg_start == currg->rg_end)) /* Invalid memory identify */
         {
-            printf ("Error: in mm-vm.c / __write() :\n");
-            printf ("Segmentation fault. Can not get region %d OR vma %d.\n",
-                    rgid, vmaid);
+            log_printf (LOG_ERROR, "Error: in mm-vm.c / __write() :\n");
+            log_printf (LOG_ERROR,
+                        "Segmentation fault. Can not get region %d OR vma %d.\n",
+                        rgid, vmaid);
             return -1;
         }
 
     if (currg->rg_start + offset < currg->rg_start
         || currg->rg_start + offset > currg->rg_end)
         {
-            printf ("Error: in mm-vm.c / __write() :\n");
-            printf ("Segmentation fault. Accessing out-of-range region.\n");
+            log_printf (LOG_ERROR, "Error: in mm-vm.c / __write() :\n");
+            log_printf (LOG_ERROR,
+                        "Segmentation fault. Accessing out-of-range region.\n");
             return -1;
         }
 
@@ -601,15 +612,16 @@ pgwrite (struct pcb_t *proc,   // Process executing the instruction
          uint32_t destination, // Index of destination register
          uint32_t offset)
 {
-#ifdef IODUMP
-    printf ("write val=%d ==> region=%d,offset=%d,pid=%d\n", data, destination,
-            offset, proc->pid),
-    printf("Before write:\n");
-#ifdef PAGETBL_DUMP
-        print_pgtbl (proc, 0, -1); // print max TBL
-#endif
-    MEMPHY_dump (proc->mram);
-#endif
+    if (log_enabled (LOG_IO))
+        {
+            log_printf (LOG_IO,
+                        "write val=%d ==> region=%d,offset=%d,pid=%d\n", data,
+                        destination, offset, proc->pid);
+            log_printf (LOG_IO, "Before write:\n");
+            if (log_enabled (LOG_DUMP))
+                print_pgtbl (proc, 0, -1); // print max TBL
+            MEMPHY_dump (proc->mram);
+        }
 
     int stat = __write (proc, 0, destination, offset, data);
 
@@ -618,13 +630,13 @@ pgwrite (struct pcb_t *proc,   // Process executing the instruction
         return stat;
     }
 
-#ifdef IODUMP
-    printf("After write:\n");
-#ifdef PAGETBL_DUMP
-        print_pgtbl (proc, 0, -1); // print max TBL
-#endif
-    MEMPHY_dump (proc->mram);
-#endif
+    if (log_enabled (LOG_IO))
+        {
+            log_printf (LOG_IO, "After write:\n");
+            if (log_enabled (LOG_DUMP))
+                print_pgtbl (proc, 0, -1); // print max TBL
+            MEMPHY_dump (proc->mram);
+        }
 
     return stat;
 }
@@ -746,8 +758,9 @@ inc_vma_limit (struct pcb_t *caller, int vmaid, int inc_sz)
                     newrg)
         < 0)
         {
-            printf ("Error: in mm.c / inc_vma_limit() :\n");
-            printf("vm_map_ram() not successful. Perhaps not enough frames.\n");
+            log_printf (LOG_ERROR, "Error: in mm.c / inc_vma_limit() :\n");
+            log_printf (LOG_ERROR,
+                        "vm_map_ram() not successful. Perhaps not enough frames.\n");
             return -1; /* Map the memory to MEMRAM */
         }
 
@@ -816,8 +829,9 @@ get_free_vmrg_area (struct pcb_t *caller, int vmaid, int size,
 
     if (cur_vma == NULL)
         {
-            printf ("Error: in mm-vm.c / get_free_vmrg_area() :\n");
-            printf ("Can not get current vma.\n");
+            log_printf (LOG_ERROR,
+                        "Error: in mm-vm.c / get_free_vmrg_area() :\n");
+            log_printf (LOG_ERROR, "Can not get current vma.\n");
             return -1;
         }
 
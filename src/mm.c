@@ -12,6 +12,7 @@
  */
 
 #include "mm.h"
+#include "log.h"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -152,8 +153,9 @@ vmap_page_range (struct pcb_t *caller, int addr, int pgnum,
 
             if (pg_getpage (caller->mm, pgn, &fpn, caller) != 0)
                 {
-                    printf ("Error: in mm.c / vmap_page_range() :\n");
-                    printf ("pg_getpage() is not sucessful.\n");
+                    log_printf (LOG_ERROR,
+                                "Error: in mm.c / vmap_page_range() :\n");
+                    log_printf (LOG_ERROR, "pg_getpage() is not sucessful.\n");
                     return -1;
                 } // Try to get a frame for [pgn]
 
@@ -305,7 +307,7 @@ vm_map_ram (struct pcb_t *caller, int astart, int aend, int mapstart,
     if (ret_alloc == -3000)
         {
 #ifdef MMDBG
-            printf ("OOM: vm_map_ram out of memory \n");
+            log_printf (LOG_ERROR, "OOM: vm_map_ram out of memory \n");
 #endif
             return -1;
         }
@@ -453,19 +455,19 @@ print_list_fp (struct framephy_struct *ifp)
 {
     struct framephy_struct *fp = ifp;
 
-    printf ("print_list_fp: ");
+    log_printf (LOG_INFO, "print_list_fp: ");
     if (fp == NULL)
         {
-            printf ("NULL list\n");
+            log_printf (LOG_INFO, "NULL list\n");
             return -1;
         }
-    printf ("\n");
+    log_printf (LOG_INFO, "\n");
     while (fp != NULL)
         {
-            printf ("fp[%d]\n", fp->fpn);
+            log_printf (LOG_INFO, "fp[%d]\n", fp->fpn);
             fp = fp->fp_next;
         }
-    printf ("\n");
+    log_printf (LOG_INFO, "\n");
     return 0;
 }
 
@@ -474,19 +476,19 @@ print_list_rg (struct vm_rg_struct *irg)
 {
     struct vm_rg_struct *rg = irg;
 
-    printf ("print_list_rg: ");
+    log_printf (LOG_INFO, "print_list_rg: ");
     if (rg == NULL)
         {
-            printf ("NULL list\n");
+            log_printf (LOG_INFO, "NULL list\n");
             return -1;
         }
-    printf ("\n");
+    log_printf (LOG_INFO, "\n");
     while (rg != NULL)
         {
-            printf ("rg[%ld->%ld]\n", rg->rg_start, rg->rg_end);
+            log_printf (LOG_INFO, "rg[%ld->%ld]\n", rg->rg_start, rg->rg_end);
             rg = rg->rg_next;
         }
-    printf ("\n");
+    log_printf (LOG_INFO, "\n");
     return 0;
 }
 
@@ -495,38 +497,39 @@ print_list_vma (struct vm_area_struct *ivma)
 {
     struct vm_area_struct *vma = ivma;
 
-    printf ("print_list_vma: ");
+    log_printf (LOG_INFO, "print_list_vma: ");
     if (vma == NULL)
         {
-            printf ("NULL list\n");
+            log_printf (LOG_INFO, "NULL list\n");
             return -1;
         }
-    printf ("\n");
+    log_printf (LOG_INFO, "\n");
     while (vma != NULL)
         {
-            printf ("va[%ld->%ld]\n", vma->vm_start, vma->vm_end);
+            log_printf (LOG_INFO, "va[%ld->%ld]\n", vma->vm_start,
+                        vma->vm_end);
             vma = vma->vm_next;
         }
-    printf ("\n");
+    log_printf (LOG_INFO, "\n");
     return 0;
 }
 
 int
 print_list_pgn (struct pgn_t *ip)
 {
-    printf ("print_list_pgn: ");
+    log_printf (LOG_INFO, "print_list_pgn: ");
     if (ip == NULL)
         {
-            printf ("NULL list\n");
+            log_printf (LOG_INFO, "NULL list\n");
             return -1;
         }
-    printf ("\n");
+    log_printf (LOG_INFO, "\n");
     while (ip != NULL)
         {
-            printf ("va[%d]-\n", ip->pgn);
+            log_printf (LOG_INFO, "va[%d]-\n", ip->pgn);
             ip = ip->pg_next;
         }
-    printf ("n");
+    log_printf (LOG_INFO, "n");
     return 0;
 }
 
@@ -544,22 +547,19 @@ print_pgtbl (struct pcb_t *caller, uint32_t start, uint32_t end)
         }
     pgn_start = PAGING_PGN (start);
     pgn_end = PAGING_PGN (end);
-    flockfile (stdout); // To avoid the dump messages
-                        // interleaved by external messages
-    printf ("print_pgtbl: %d - %d", start, end);
+    log_printf (LOG_INFO, "print_pgtbl: %d - %d", start, end);
     if (caller == NULL)
         {
-            printf ("NULL caller\n");
+            log_printf (LOG_INFO, "NULL caller\n");
             return -1;
         }
-    printf ("\n");
+    log_printf (LOG_INFO, "\n");
 
     for (pgit = pgn_start; pgit < pgn_end; pgit++)
         {
-            printf ("%08ld: %08x\n", pgit * sizeof (uint32_t),
-                    caller->mm->pgd[pgit]);
+            log_printf (LOG_INFO, "%08ld: %08x\n", pgit * sizeof (uint32_t),
+                        caller->mm->pgd[pgit]);
         }
-    funlockfile (stdout); // Follows the above flockfile()
     return 0;
 }
 
@@ -0,0 +1,97 @@
+/**
+ * @file mpmc.c
+ * @category Implementation source code
+ * @brief
+ *      Implementation from `mpmc.h` interface
+ */
+#include "mpmc.h"
+#include <stdlib.h>
+
+int
+mpmc_init (struct mpmc_queue_t *q, unsigned long capacity)
+{
+    unsigned long cap = 2;
+    unsigned long i;
+
+    while (cap < capacity)
+        cap <<= 1;
+
+    q->cells = malloc (sizeof (struct mpmc_cell_t) * cap);
+    if (q->cells == NULL)
+        return -1;
+    for (i = 0; i < cap; i++)
+        q->cells[i].seq = i; // cell i is free for the producer at pos i
+    q->mask = cap - 1;
+    q->enqueue_pos = 0;
+    q->dequeue_pos = 0;
+    return 0;
+}
+
+void
+mpmc_destroy (struct mpmc_queue_t *q)
+{
+    free (q->cells);
+    q->cells = NULL;
+}
+
+int
+mpmc_enqueue (struct mpmc_queue_t *q, struct pcb_t *proc)
+{
+    struct mpmc_cell_t *cell;
+    unsigned long pos = __atomic_load_n (&q->enqueue_pos, __ATOMIC_RELAXED);
+
+    while (1)
+        {
+            cell = &q->cells[pos & q->mask];
+            unsigned long seq = __atomic_load_n (&cell->seq, __ATOMIC_ACQUIRE);
+            long diff = (long)seq - (long)pos;
+            if (diff == 0) // free cell, try to claim it
+                {
+                    if (__atomic_compare_exchange_n (&q->enqueue_pos, &pos,
+                                                     pos + 1, 1,
+                                                     __ATOMIC_RELAXED,
+                                                     __ATOMIC_RELAXED))
+                        break;
+                    // on failure, `pos` has been reloaded by the CAS
+                }
+            else if (diff < 0) // the consumer one lap behind did not free it
+                return -1;
+            else // another producer took this position
+                pos = __atomic_load_n (&q->enqueue_pos, __ATOMIC_RELAXED);
+        }
+
+    cell->proc = proc;
+    __atomic_store_n (&cell->seq, pos + 1, __ATOMIC_RELEASE); // publish
+    return 0;
+}
+
+struct pcb_t *
+mpmc_dequeue (struct mpmc_queue_t *q)
+{
+    struct mpmc_cell_t *cell;
+    unsigned long pos = __atomic_load_n (&q->dequeue_pos, __ATOMIC_RELAXED);
+
+    while (1)
+        {
+            cell = &q->cells[pos & q->mask];
+            unsigned long seq = __atomic_load_n (&cell->seq, __ATOMIC_ACQUIRE);
+            long diff = (long)seq - (long)(pos + 1);
+            if (diff == 0) // published cell, try to claim it
+                {
+                    if (__atomic_compare_exchange_n (&q->dequeue_pos, &pos,
+                                                     pos + 1, 1,
+                                                     __ATOMIC_RELAXED,
+                                                     __ATOMIC_RELAXED))
+                        break;
+                }
+            else if (diff < 0) // nothing published yet
+                return NULL;
+            else // another consumer took this position
+                pos = __atomic_load_n (&q->dequeue_pos, __ATOMIC_RELAXED);
+        }
+
+    struct pcb_t *proc = cell->proc;
+    /* free the cell for the producer one lap ahead */
+    __atomic_store_n (&cell->seq, pos + q->mask + 1, __ATOMIC_RELEASE);
+    return proc;
+}
@@ -6,18 +6,31 @@
  */
 #include "cpu.h"
 #include "loader.h"
+#include "log.h"
 #include "mm.h"
 #include "sched.h"
+#include "stats.h"
 #include "timer.h"
 
+#include <ctype.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+#define CLOCK_MAX 65536 // instructions per slot, see `clock`
 
 static int time_slot;
-static int num_cpus;
+static int clock_rate = 1; // instructions per slot, set by a `clock` line
+static int num_cpus;  // CPUs of the machine, online or not
+static int nr_online; // CPUs online, the first ones
+static int single_thread = 0;
+static int nr_workers = -1; // host threads running the CPUs, -1 for one
+                            // each, set by a `workers` config line
 static int done = 0;
+static char sched_policy[16] = "mlq"; // set by a `sched` config line
+static char stats_path[100] = ""; // CSV file, set by a `stats` config line
 
 #ifdef MM_PAGING
 static int memramsz;
@@ -29,7 +42,6 @@ struct mmpaging_ld_args
     struct memphy_struct *mram;
     struct memphy_struct **mswp;
     struct memphy_struct *active_mswp;
-    struct timer_id_t *timer_id;
 };
 #endif
 
@@ -39,6 +51,7 @@ static struct ld_args
     unsigned long *start_time;
 #ifdef MLQ_SCHED
     unsigned long *prio;
+    unsigned long *deadline; // relative, 0 if none
 #endif
 } ld_processes;
 int num_processes;
@@ -47,144 +60,542 @@ struct cpu_args
 {
     struct timer_id_t *timer_id;
     int id;
+    struct pcb_t *proc; // running process, NULL if none
+    int time_left;      // instructions left in its quantum
+    int active;         // stepped in every slot, until it stops
+    int started;        // `thread` is to be joined
+    pthread_t thread;
 };
 
+static struct cpu_args *cpus;
+
+/**
+ * @brief
+ *      A host thread of the M:N engine. Worker `id` runs CPUs id, id +
+ * nr_workers, ... in turn in every slot, so that a CPU always logs from
+ * the same thread, and the timer only handshakes with the workers.
+ */
+static struct worker_args
+{
+    struct timer_id_t *timer_id;
+    int id;
+    pthread_t thread;
+} *workers = NULL;
+static int pool_active = 0; // CPUs active, the workers stop at 0
+
+/* An `at` directive: `cpus` CPUs are online from slot `slot` */
+static struct hotplug_t
+{
+    uint64_t slot;
+    int cpus;
+    struct timer_event_t event;
+} *hotplug = NULL;
+static int nr_hotplug = 0;
+static int hp_pending = 0; // `at` events which have not fired yet
+static int hp_leaving = 0; // CPUs gone offline, their work not handed over
+
+/**
+ * @brief
+ *      Whether a CPU with nothing to run may stop for good: the loader is
+ * done, no process is queued, and no CPU can be taken offline and hand its
+ * work over any more.
+ */
+static int
+cpu_may_stop (void)
+{
+    return done && queue_empty () == 1
+           && __atomic_load_n (&hp_pending, __ATOMIC_ACQUIRE) == 0
+           && __atomic_load_n (&hp_leaving, __ATOMIC_ACQUIRE) == 0;
+}
+
+/* What a CPU or the loader does in the slot after a step */
+enum dev_state
+{
+    DEV_RUN,   // it has worked in this slot
+    DEV_IDLE,  // nothing to do, it looks again in the next slot
+    DEV_STOP,  // it is done for good
+};
+
+/**
+ * @brief
+ *      One slot of a CORE: dispatch a process if needed, and run it for one
+ * slot. Shared by the threaded and the single-threaded engines.
+ */
+static enum dev_state
+cpu_step (struct cpu_args *cpu)
+{
+    int id = cpu->id;
+    int ran;
+
+    if (!sched_online (id))
+        {
+            /* Taken offline at this boundary: give the work away */
+            if (cpu->proc != NULL)
+                {
+                    log_printf (LOG_INFO,
+                                "\tCPU %d: Put process %2d to run queue\n",
+                                id, cpu->proc->pid);
+                    stats_put (cpu->proc, current_time ());
+                    put_cpu_proc (id, cpu->proc);
+                    cpu->proc = NULL;
+                }
+            sched_migrate (id);
+            __atomic_sub_fetch (&hp_leaving, 1, __ATOMIC_RELEASE);
+            log_printf (LOG_INFO, "\tCPU %d offline\n", id);
+            return DEV_STOP;
+        }
+    /**
+     * Check the status of the current process.
+     * The following scenarios can occur:
+     *  - No process -> continue finding new process.
+     *  - Process finished -> load new process, set time_left = 0
+     *  - Process overdue its time_slot -> put it back to the queue
+     *                                      and get new process
+     *
+     *  Overall result: will have some process loaded.
+     */
+    if (cpu->proc == NULL)
+        {
+            /* No process is running, the we load new process from
+             * ready queue, unless we are parked until a process is
+             * queued */
+            if (!sched_parked (id))
+                cpu->proc = get_cpu_proc (id);
+            if (cpu->proc == NULL && !done)
+                {
+                    if (!sched_parked (id))
+                        sched_park (id);
+                    return DEV_IDLE; /* First load failed. skip dummy load */
+                }
+        }
+    else if (cpu->proc->pc == cpu->proc->code->size)
+        {
+            /* The process has finish it job */
+            log_printf (LOG_INFO, "\tCPU %d: Process %2d has finished\n", id,
+                        cpu->proc->pid);
+            stats_exit (id, cpu->proc, current_time ());
+            sched_exit (id, cpu->proc);
+            free (cpu->proc);
+            cpu->proc = get_cpu_proc (id);
+            cpu->time_left = 0;
+        }
+    else if (cpu->time_left == 0 || sched_need_resched (id))
+        {
+            /* The process has done its job in current time slot, or
+             * a more urgent process has arrived for this CPU */
+            log_printf (LOG_INFO, "\tCPU %d: Put process %2d to run queue\n",
+                        id, cpu->proc->pid);
+            stats_put (cpu->proc, current_time ());
+            put_cpu_proc (id, cpu->proc);
+            cpu->proc = get_cpu_proc (id);
+            cpu->time_left = 0;
+        }
+
+    /* Recheck process status after loading new process */
+    /**
+     * After loaded a new process (or reusing the process) from above.
+     * We check for the process status for the second time.
+     *
+     *  - If the loader is done, and no process currently waiting, then
+     *
+     */
+    if (cpu->proc == NULL && cpu_may_stop ())
+        {
+            /* No process to run, exit */
+            log_printf (LOG_INFO, "\tCPU %d stopped\n", id);
+            return DEV_STOP;
+        }
+    else if (cpu->proc == NULL)
+        {
+            /* There may be new processes to run in
+             * next time slots, just skip current slot */
+            sched_park (id);
+            return DEV_IDLE;
+        }
+    else if (cpu->time_left == 0) // the process has just been reloaded
+                                  // from the queue
+        {
+            log_printf (LOG_INFO, "\tCPU %d: Dispatched process %2d\n", id,
+                        cpu->proc->pid);
+            cpu->time_left
+                = get_time_slice (id, cpu->proc, time_slot) * clock_rate;
+            stats_dispatch (id, cpu->proc, current_time ());
+        }
+
+    /* Run current process, for up to a clock of its quantum */
+    ran = run_ops (cpu->proc, cpu->time_left < clock_rate ? cpu->time_left
+                                                          : clock_rate);
+    stats_run (cpu->proc, ran);
+    sched_tick (id, cpu->proc, current_time ());
+    cpu->time_left -= ran;
+    return DEV_RUN;
+}
+
 /**
  * @brief A separate thread as an independent running instance, for a CORE.
  */
 static void *
 cpu_routine (void *args)
 {
-    struct timer_id_t *timer_id = ((struct cpu_args *)args)->timer_id;
-    int id = ((struct cpu_args *)args)->id;
-    /* Check for new process in ready queue */
-    int time_left = 0;
-    struct pcb_t *proc = NULL;
+    struct cpu_args *cpu = (struct cpu_args *)args;
+    enum dev_state state;
+
+    log_set_source (cpu->id + 1);
+    join_slot (cpu->timer_id);
+    while ((state = cpu_step (cpu)) != DEV_STOP)
+        {
+            if (state == DEV_RUN)
+                next_slot (cpu->timer_id);
+            else
+                idle_slot (cpu->timer_id);
+        }
+    cpu->active = 0;
+    detach_event (cpu->timer_id);
+    pthread_exit (NULL);
+}
+
+/**
+ * @brief
+ *      A thread of the M:N engine: one step of each of its active CPUs,
+ * then the slot barrier, as the CPU threads would do. It waits for the
+ * next slot if any of them has worked, else it is idle.
+ */
+static void *
+worker_routine (void *args)
+{
+    struct worker_args *worker = (struct worker_args *)args;
+    enum dev_state state;
+    int ran, i;
+
+    join_slot (worker->timer_id);
     while (1)
         {
-            /**
-             * Check the status of the current process.
-             * The following scenarios can occur:
-             *  - No process -> continue finding new process.
-             *  - Process finished -> load new process, set time_left = 0
-             *  - Process overdue its time_slot -> put it back to the queue
-             *                                      and get new process
-             *
-             *  Overall result: will have some process loaded.
-             */
-            if (proc == NULL)
+            ran = 0;
+            for (i = worker->id; i < num_cpus; i += nr_workers)
                 {
-                    /* No process is running, the we load new process from
-                     * ready queue */
-                    proc = get_proc ();
-                    if (proc == NULL)
+                    if (!cpus[i].active)
+                        continue;
+                    log_set_source (i + 1);
+                    state = cpu_step (&cpus[i]);
+                    if (state == DEV_STOP)
                         {
-                            next_slot (timer_id);
-                            continue; /* First load failed. skip dummy load */
+                            cpus[i].active = 0;
+                            __atomic_sub_fetch (&pool_active, 1,
+                                                __ATOMIC_RELEASE);
                         }
+                    else if (state == DEV_RUN)
+                        ran = 1;
                 }
-            else if (proc->pc == proc->code->size)
-                {
-                    /* The process has finish it job */
-                    printf ("\tCPU %d: Process %2d has finished\n", id,
-                            proc->pid);
-                    free (proc);
-                    proc = get_proc ();
-                    time_left = 0;
-                }
-            else if (time_left == 0)
-                {
-                    /* The process has done its job in current time slot */
-                    printf ("\tCPU %d: Put process %2d to run queue\n", id,
-                            proc->pid);
-                    put_proc (proc);
-                    proc = get_proc ();
-                }
+            /* CPUs only come up at a boundary, none can come while we
+             * check: if all have stopped, so has the machine */
+            if (__atomic_load_n (&pool_active, __ATOMIC_ACQUIRE) == 0)
+                break;
+            if (ran)
+                next_slot (worker->timer_id);
+            else
+                idle_slot (worker->timer_id);
+        }
+    detach_event (worker->timer_id);
+    pthread_exit (NULL);
+}
 
-            /* Recheck process status after loading new process */
-            /**
-             * After loaded a new process (or reusing the process) from above.
-             * We check for the process status for the second time.
-             *
-             *  - If the loader is done, and no process currently waiting, then
-             *
-             */
-            if (proc == NULL && done)
-                {
-                    /* No process to run, exit */
-                    printf ("\tCPU %d stopped\n", id);
-                    break;
-                }
-            else if (proc == NULL)
-                {
-                    /* There may be new processes to run in
-                     * next time slots, just skip current slot */
-                    next_slot (timer_id);
-                    continue;
-                }
-            else if (time_left == 0) // the process has just been reloaded
-                                     // from the queue
+/* Start the workers of the M:N engine, before the timer */
+static void
+pool_start (void)
+{
+    int i;
+
+    if (nr_workers == 0)
+        nr_workers = sysconf (_SC_NPROCESSORS_ONLN);
+    if (nr_workers > num_cpus)
+        nr_workers = num_cpus;
+    if (nr_workers < 1)
+        nr_workers = 1;
+    workers = calloc (nr_workers, sizeof (struct worker_args));
+    for (i = 0; i < nr_workers; i++)
+        {
+            workers[i].id = i;
+            workers[i].timer_id = attach_event ();
+            if (workers[i].timer_id == NULL)
                 {
-                    printf ("\tCPU %d: Dispatched process %2d\n", id,
-                            proc->pid);
-                    time_left = time_slot;
+                    printf ("Error: in os.c / pool_start() :\n");
+                    printf ("Too many workers for the timer.\n");
+                    exit (1);
                 }
-                
-            /* Run current process */
-            run (proc);
-            time_left--;
-            next_slot (timer_id);
+            pthread_create (&workers[i].thread, NULL, worker_routine,
+                            (void *)&workers[i]);
         }
-    detach_event (timer_id);
-    pthread_exit (NULL);
+}
+
+/* Bring up CPU `cpu`: with its own thread, unless single-threaded or
+ * run by the workers */
+static void
+cpu_start (struct cpu_args *cpu)
+{
+    cpu->proc = NULL;
+    cpu->time_left = 0;
+    cpu->active = 1;
+    if (single_thread)
+        return;
+    if (nr_workers >= 0)
+        {
+            __atomic_add_fetch (&pool_active, 1, __ATOMIC_RELEASE);
+            return;
+        }
+    if (cpu->started) // a previous thread, detached already
+        pthread_join (cpu->thread, NULL);
+    cpu->timer_id = attach_event ();
+    if (cpu->timer_id == NULL)
+        {
+            log_printf (LOG_ERROR, "Error: in os.c / cpu_start() :\n");
+            log_printf (LOG_ERROR, "Too many devices for the timer.\n");
+            exit (1);
+        }
+    pthread_create (&cpu->thread, NULL, cpu_routine, (void *)cpu);
+    cpu->started = 1;
 }
 
 /**
- * @brief Loader as an independent running instance, for a LOADER
+ * @brief
+ *      Event of an `at` directive: bring CPUs online or offline, from the
+ * highest id, until `cpus` of them are online. An offline CPU puts its
+ * process back and hands its queue over in its next slot, then stops.
  */
-static void *
-ld_routine (void *args)
+static void
+cpu_hotplug (void *arg)
 {
+    int target = ((struct hotplug_t *)arg)->cpus;
+    int i;
+
+    log_printf (LOG_INFO, "\tCPUs online: %d -> %d\n", nr_online, target);
+    for (i = nr_online; i < target; i++)
+        {
+            sched_set_online (i, 1);
+            if (!cpus[i].active)
+                cpu_start (&cpus[i]);
+            else // it has not stopped yet, it keeps its work
+                __atomic_sub_fetch (&hp_leaving, 1, __ATOMIC_RELEASE);
+        }
+    for (i = target; i < nr_online; i++)
+        {
+            sched_set_online (i, 0);
+            if (cpus[i].active) // it hands its work over in its next slot
+                __atomic_add_fetch (&hp_leaving, 1, __ATOMIC_RELEASE);
+        }
+    nr_online = target;
+    __atomic_sub_fetch (&hp_pending, 1, __ATOMIC_RELEASE);
+}
+
+static struct timer_event_t *ld_events; // arrival of each process
+static void *ld_mm_args;                 // struct mmpaging_ld_args
+static int ld_nr_arrived = 0;
+
+/* All processes have arrived: the CPUs stop once they run out of work */
+static void
+ld_finish (void)
+{
+    free (ld_processes.path);
+    free (ld_processes.start_time);
+#ifdef MLQ_SCHED
+    free (ld_processes.prio);
+    free (ld_processes.deadline);
+#endif
+    free (ld_events);
+    done = 1;
+}
+
+/**
+ * @brief
+ *      Arrival event of process `arg`, the index in the configure file: the
+ * LOADER adds it to the ready queues. It fires at the boundary of its start
+ * slot, before the CPUs run in it.
+ */
+static void
+ld_arrive (void *arg)
+{
+    int i = (int)(intptr_t)arg;
+    struct pcb_t *proc = load (ld_processes.path[i]);
+#ifdef MLQ_SCHED
+    proc->prio = ld_processes.prio[i];
+#endif
 #ifdef MM_PAGING
-    struct memphy_struct *mram = ((struct mmpaging_ld_args *)args)->mram;
-    struct memphy_struct **mswp = ((struct mmpaging_ld_args *)args)->mswp;
-    struct memphy_struct *active_mswp
-        = ((struct mmpaging_ld_args *)args)->active_mswp;
-    struct timer_id_t *timer_id = ((struct mmpaging_ld_args *)args)->timer_id;
+    struct mmpaging_ld_args *mm_args = (struct mmpaging_ld_args *)ld_mm_args;
+    proc->mm = malloc (sizeof (struct mm_struct));
+    init_mm (proc->mm, proc);
+    proc->mram = mm_args->mram;
+    proc->mswp = mm_args->mswp;
+    proc->active_mswp = mm_args->active_mswp;
+#endif
+    log_printf (LOG_INFO,
+                "\tLoaded a process at %s, PID: %d PRIO: %lu, at time %llu\n",
+                ld_processes.path[i], proc->pid,
+#ifdef MLQ_SCHED
+                ld_processes.prio[i],
 #else
-    struct timer_id_t *timer_id = (struct timer_id_t *)args;
+                (unsigned long)proc->priority,
 #endif
-    int i = 0;
-    printf ("ld_routine\n");
-    while (i < num_processes)
-        {
-            struct pcb_t *proc = load (ld_processes.path[i]);
+                (unsigned long long)current_time ());
+    stats_arrive (proc, current_time ());
 #ifdef MLQ_SCHED
-            proc->prio = ld_processes.prio[i];
+    if (ld_processes.deadline[i] != 0
+        && sched_admit_deadline (proc, current_time (),
+                                 ld_processes.deadline[i])
+               != 0)
+        log_printf (LOG_INFO,
+                    "\tPID %d can not meet its deadline, run without\n",
+                    proc->pid);
 #endif
-            while (current_time () < ld_processes.start_time[i])
+    add_proc (proc);
+    free (ld_processes.path[i]);
+    if (++ld_nr_arrived == num_processes)
+        ld_finish ();
+}
+
+/**
+ * @brief
+ *      Start the LOADER: arm the arrival of every process on the timing
+ * wheel, instead of polling the clock for the next one in every slot.
+ */
+static void
+ld_start (void *args)
+{
+    int i;
+
+    ld_mm_args = args;
+    ld_events = calloc (num_processes, sizeof (struct timer_event_t));
+    if (num_processes == 0)
+        ld_finish ();
+    for (i = 0; i < num_processes; i++)
+        schedule_event (&ld_events[i], ld_processes.start_time[i], ld_arrive,
+                        (void *)(intptr_t)i);
+}
+
+/**
+ * @brief
+ *      Single-threaded engine: simulate CPU 0, 1, ... in this fixed order in
+ * every slot, in the calling thread, after the arrivals of the slot. The
+ * log is the same on every run. Empty slots are skipped as the timer does.
+ */
+static void
+run_single_thread (void)
+{
+    enum dev_state state;
+    int nr_active, ran, i;
+
+    start_clock ();
+    while (1)
+        {
+            ran = nr_active = 0;
+            for (i = 0; i < num_cpus; i++)
                 {
-                    next_slot (timer_id);
+                    if (!cpus[i].active)
+                        continue;
+                    log_set_source (i + 1);
+                    state = cpu_step (&cpus[i]);
+                    if (state == DEV_STOP)
+                        cpus[i].active = 0;
+                    else
+                        nr_active++;
+                    if (state == DEV_RUN)
+                        ran++;
                 }
-#ifdef MM_PAGING
-            proc->mm = malloc (sizeof (struct mm_struct));
-            init_mm (proc->mm, proc);
-            proc->mram = mram;
-            proc->mswp = mswp;
-            proc->active_mswp = active_mswp;
-#endif
-            printf ("\tLoaded a process at %s, PID: %d PRIO: %ld, at time %llu\n",
-                    ld_processes.path[i], proc->pid, ld_processes.prio[i], current_time());
-            add_proc (proc);
-            free (ld_processes.path[i]);
-            i++;
-            next_slot (timer_id);
+            log_set_source (0);
+            if (nr_active == 0)
+                break;
+            step_time (!ran);
         }
-    free (ld_processes.path);
-    free (ld_processes.start_time);
-    done = 1;
-    detach_event (timer_id);
-    pthread_exit (NULL);
+}
+
+/**
+ * @brief
+ *      Apply a directive line of the configure file. Directives start with
+ * a letter, and may come anywhere after the memory line:
+ *      sched [mlq | cfs | mlfq | prio | rr]
+ *                                      scheduling policy, mlq by default
+ *      stats [path]                    write the process statistics to a
+ *                                      CSV file, none by default
+ *      aging [rate]                    MLQ aging rate, 0 disables it, as
+ *                                      by default
+ *      mlfq [q0] [q1] ...              MLFQ quanta, from the highest level
+ *      at [slot] cpus [n]              n CPUs online from that slot on, the
+ *                                      first line gives those at slot 0
+ *      log [error | info | io | dump]  verbosity, LOG_DEFAULT_LEVEL by
+ *                                      default
+ *      clock [k]                       instructions a CPU runs in a slot,
+ *                                      1 by default, quanta are k times
+ *                                      as many instructions as slots
+ *      workers [n]                     run the CPUs on n host threads, 0
+ *                                      for one per host core, instead of
+ *                                      a thread per CPU
+ */
+static void
+read_directive (const char *line)
+{
+    char key[32];
+    char what[16];
+    int rate;
+    unsigned long slot;
+    sscanf (line, "%31s", key);
+    if (!strcmp (key, "sched")
+        && sscanf (line, "%*s %15s", sched_policy) == 1)
+        return;
+    if (!strcmp (key, "stats") && sscanf (line, "%*s %99s", stats_path) == 1)
+        return;
+    if (!strcmp (key, "aging") && sscanf (line, "%*s %d", &rate) == 1
+        && rate >= 0 && sched_set_aging (rate) == 0)
+        return;
+    if (!strcmp (key, "mlfq"))
+        {
+            int quanta[MLFQ_MAX_LEVELS + 1];
+            int n = 0, len = 0, pos;
+            sscanf (line, "%*s%n", &pos);
+            while (n <= MLFQ_MAX_LEVELS
+                   && sscanf (line + pos, "%d%n", &quanta[n], &len) == 1)
+                {
+                    pos += len;
+                    n++;
+                }
+            if (sched_set_mlfq_quanta (quanta, n) == 0)
+                return;
+        }
+    if (!strcmp (key, "at")
+        && sscanf (line, "%*s %lu %15s %d", &slot, what, &rate) == 3
+        && !strcmp (what, "cpus") && rate > 0)
+        {
+            if (slot == 0)
+                {
+                    nr_online = rate;
+                    return;
+                }
+            hotplug = realloc (hotplug,
+                               sizeof (struct hotplug_t) * (nr_hotplug + 1));
+            hotplug[nr_hotplug].slot = slot;
+            hotplug[nr_hotplug].cpus = rate;
+            hotplug[nr_hotplug].event.next = NULL;
+            nr_hotplug++;
+            return;
+        }
+    if (!strcmp (key, "log") && sscanf (line, "%*s %15s", what) == 1
+        && (rate = log_parse_level (what)) >= 0)
+        {
+            log_set_level (rate);
+            return;
+        }
+    if (!strcmp (key, "clock") && sscanf (line, "%*s %d", &rate) == 1
+        && rate > 0 && rate <= CLOCK_MAX)
+        {
+            clock_rate = rate;
+            sched_set_clock (rate);
+            return;
+        }
+    if (!strcmp (key, "workers") && sscanf (line, "%*s %d", &rate) == 1
+        && rate >= 0)
+        {
+            nr_workers = rate;
+            return;
+        }
+    printf ("Unknown configure directive: %s", line);
+    exit (1);
 }
 
 /* Subroutine reading the configuration and */
@@ -198,6 +609,7 @@ read_config (const char *path)
             exit (1);
         }
     fscanf (file, "%d %d %d\n", &time_slot, &num_cpus, &num_processes);
+    nr_online = num_cpus;
     ld_processes.path = (char **)malloc (sizeof (char *) * num_processes);
     ld_processes.start_time
         = (unsigned long *)malloc (sizeof (unsigned long) * num_processes);
@@ -229,54 +641,72 @@ read_config (const char *path)
 #ifdef MLQ_SCHED
     ld_processes.prio
         = (unsigned long *)malloc (sizeof (unsigned long) * num_processes);
+    ld_processes.deadline
+        = (unsigned long *)calloc (num_processes, sizeof (unsigned long));
 #endif
-    int i;
-    for (i = 0; i < num_processes; i++)
+    int i = 0;
+    char line[256];
+    while (fgets (line, sizeof (line), file) != NULL)
         {
-            ld_processes.path[i] = (char *)malloc (sizeof (char) * 100);
-            ld_processes.path[i][0] = '\0';
-            strcat (ld_processes.path[i], "input/proc/");
+            if (isalpha ((unsigned char)line[0]))
+                {
+                    read_directive (line);
+                    continue;
+                }
             char proc[100];
 #ifdef MLQ_SCHED
-            fscanf (file, "%lu %s %lu\n", &ld_processes.start_time[i], proc,
-                    &ld_processes.prio[i]);
+            /* [start] [path] [prio] and an optional relative [deadline] */
+            if (i == num_processes
+                || sscanf (line, "%lu %99s %lu %lu",
+                           &ld_processes.start_time[i], proc,
+                           &ld_processes.prio[i], &ld_processes.deadline[i])
+                       < 3)
+                continue;
 #else
-            fscanf (file, "%lu %s\n", &ld_processes.start_time[i], proc);
+            if (i == num_processes
+                || sscanf (line, "%lu %99s", &ld_processes.start_time[i],
+                           proc)
+                       != 2)
+                continue;
 #endif
+            ld_processes.path[i] = (char *)malloc (sizeof (char) * 100);
+            ld_processes.path[i][0] = '\0';
+            strcat (ld_processes.path[i], "input/proc/");
             strcat (ld_processes.path[i], proc);
+            i++;
         }
+    num_processes = i; // a short file loads what it has
+    fclose (file);
+
+    /* Room for the most CPUs ever online */
+    num_cpus = nr_online;
+    for (i = 0; i < nr_hotplug; i++)
+        if (hotplug[i].cpus > num_cpus)
+            num_cpus = hotplug[i].cpus;
 }
 
 int
 main (int argc, char *argv[])
 {
     /* Read config */
-    if (argc != 2)
+    single_thread = argc == 3 && strcmp (argv[1], "--single-thread") == 0;
+    if (argc != 2 && !single_thread)
         {
-            printf ("Usage: os [path to configure file]\n");
+            printf ("Usage: os [--single-thread] [path to configure file]\n");
             return 1;
         }
     char path[100];
     path[0] = '\0';
      strcat (path, "input/");
     // set the path
-    strcat (path, argv[1]);
+    strcat (path, argv[argc - 1]);
     read_config (path);
+    log_init ();
 
-    pthread_t *cpu = (pthread_t *)malloc (num_cpus * sizeof (pthread_t));
-    struct cpu_args *args
-        = (struct cpu_args *)malloc (sizeof (struct cpu_args) * num_cpus);
-    pthread_t ld;
-
-    /* Init timer */
+    cpus = (struct cpu_args *)calloc (num_cpus, sizeof (struct cpu_args));
     int i;
     for (i = 0; i < num_cpus; i++)
-        {
-            args[i].timer_id = attach_event ();
-            args[i].id = i;
-        }
-    struct timer_id_t *ld_event = attach_event ();
-    start_timer ();
+        cpus[i].id = i;
 
 #ifdef MM_PAGING
     /* Init all MEMPHY include 1 MEMRAM and n of MEMSWP */
@@ -298,35 +728,60 @@ main (int argc, char *argv[])
     struct mmpaging_ld_args *mm_ld_args
         = malloc (sizeof (struct mmpaging_ld_args));
 
-    mm_ld_args->timer_id = ld_event;
     mm_ld_args->mram = (struct memphy_struct *)&mram;
     mm_ld_args->mswp = (struct memphy_struct **)&mswp;
     mm_ld_args->active_mswp = (struct memphy_struct *)&mswp[0];
 #endif
 
     /* Init scheduler */
-    init_scheduler ();
+    stats_init (num_cpus);
+    if (init_scheduler_policy (sched_policy, num_cpus) != 0)
+        {
+            printf ("Error: in os.c / main() :\n");
+            printf ("Unknown scheduling policy '%s'.\n", sched_policy);
+            exit (1);
+        }
+    for (i = nr_online; i < num_cpus; i++)
+        sched_set_online (i, 0);
 
-    /* Run CPU and loader */
+    /* Run CPU and loader, and arm the `at` directives first, so that the
+     * processes arriving in the same slot see the new CPUs */
+    hp_pending = nr_hotplug;
+    for (i = 0; i < nr_hotplug; i++)
+        schedule_event (&hotplug[i].event, hotplug[i].slot, cpu_hotplug,
+                        &hotplug[i]);
 #ifdef MM_PAGING
-    pthread_create (&ld, NULL, ld_routine, (void *)mm_ld_args);
+    ld_start (mm_ld_args);
 #else
-    pthread_create (&ld, NULL, ld_routine, (void *)ld_event);
+    ld_start (NULL);
 #endif
-    for (i = 0; i < num_cpus; i++)
+    for (i = 0; i < nr_online; i++)
+        cpu_start (&cpus[i]);
+    if (single_thread)
         {
-            pthread_create (&cpu[i], NULL, cpu_routine, (void *)&args[i]);
+            run_single_thread ();
+            goto report;
         }
+    if (nr_workers >= 0)
+        pool_start ();
+    start_timer ();
 
-    /* Wait for CPU and loader finishing */
-    for (i = 0; i < num_cpus; i++)
-        {
-            pthread_join (cpu[i], NULL);
-        }
-    pthread_join (ld, NULL);
-
-    /* Stop timer */
+    /* Wait for CPU finishing: the timer ends once they have all detached,
+     * no more can come up then */
     stop_timer ();
+    for (i = 0; i < num_cpus; i++)
+        if (cpus[i].started)
+            pthread_join (cpus[i].thread, NULL);
+    for (i = 0; i < nr_workers; i++)
+        pthread_join (workers[i].thread, NULL);
+    free (workers);
+report:
+    log_finish ();
+    sched_stats ();
+    stats_report (stdout);
+    if (stats_path[0] != '\0' && stats_write_csv (stats_path) != 0)
+        printf ("Cannot write statistics to %s\n", stats_path);
+    stats_finish ();
 
     return 0;
 }
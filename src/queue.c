@@ -16,33 +16,158 @@ empty (struct queue_t *q)
     return (q->size == 0);
 }
 
-void
+/**
+ * @brief
+ *      Store `proc` as the i-th element from the front, in both halves of
+ *      the mirrored buffer.
+ */
+static inline void
+queue_set (struct queue_t *q, int i, struct pcb_t *proc)
+{
+    int pos = (q->head + i) & (q->cap - 1);
+    q->buf[pos] = proc;
+    q->buf[pos + q->cap] = proc;
+}
+
+/**
+ * @brief
+ *      Double the capacity of the queue (or allocate the first buffer). The
+ *      elements are copied in order, so the front is at position 0 again.
+ *
+ * @return 0 on success, -1 on out of memory (the queue is left untouched).
+ */
+static int
+queue_grow (struct queue_t *q)
+{
+    int cap = q->cap ? q->cap * 2 : QUEUE_INIT_CAP;
+    struct pcb_t **buf = malloc (sizeof (struct pcb_t *) * 2 * cap);
+    if (buf == NULL)
+        return -1;
+    if (q->keys != NULL) // priority mode, the keys grow along
+        {
+            unsigned long long *keys
+                = realloc (q->keys, sizeof (unsigned long long) * cap);
+            if (keys == NULL)
+                {
+                    free (buf);
+                    return -1;
+                }
+            q->keys = keys;
+        }
+
+    for (int i = 0; i < q->size; i++)
+        {
+            buf[i] = q->proc[i];
+            buf[i + cap] = q->proc[i];
+        }
+    free (q->buf);
+    q->buf = buf;
+    q->cap = cap;
+    q->head = 0;
+    q->proc = q->buf;
+    return 0;
+}
+
+int
 enqueue (struct queue_t *q, struct pcb_t *proc)
 {
     /* TODO: put a new process to queue [q] */
-    if (q->size < MAX_QUEUE_SIZE - 1)
+#ifndef MLQ_SCHED // A single queue is ordered by the default priority
+    return enqueue_prio (q, proc, proc->priority);
+#else
+    if (q->size == q->cap && queue_grow (q) != 0)
+        return -1; // Back-pressure: tell the caller instead of dropping
+    queue_set (q, q->size, proc); // Put a proc at the rear of the queue
+    q->size++;                    // Increase the cnt
+    return 0;
+#endif
+}
+
+/*
+ * Priority mode: proc[0..size) and keys[0..size) form a binary min-heap,
+ * the children of i being 2i+1 and 2i+2. The front stays at buf[0], the
+ * mirror half of buf is unused.
+ */
+static inline void
+heap_swap (struct queue_t *q, int i, int j)
+{
+    struct pcb_t *proc = q->proc[i];
+    unsigned long long key = q->keys[i];
+    q->proc[i] = q->proc[j];
+    q->keys[i] = q->keys[j];
+    q->proc[j] = proc;
+    q->keys[j] = key;
+}
+
+static void
+heap_sift_up (struct queue_t *q, int i)
+{
+    while (i > 0 && q->keys[(i - 1) / 2] > q->keys[i])
         {
-            q->proc[q->size] = proc; // Put a proc at the front of the queue
-            q->size++;               // Increase the cnt
+            heap_swap (q, i, (i - 1) / 2);
+            i = (i - 1) / 2;
         }
 }
 
-int
-queuePeek (struct queue_t *q)
+static void
+heap_sift_down (struct queue_t *q, int i)
 {
-    int maxPrio = MAX_INT;
-    int index = -1;
+    while (1)
+        {
+            int least = i;
+            int left = 2 * i + 1, right = 2 * i + 2;
+            if (left < q->size && q->keys[left] < q->keys[least])
+                least = left;
+            if (right < q->size && q->keys[right] < q->keys[least])
+                least = right;
+            if (least == i)
+                return;
+            heap_swap (q, i, least);
+            i = least;
+        }
+}
 
-    for (int i = 0; i < q->size; i++)
+int
+enqueue_prio (struct queue_t *q, struct pcb_t *proc, uint32_t key)
+{
+    if (q->keys == NULL)
         {
-            if (maxPrio > q->proc[i]->priority)
-                {
-                    maxPrio = q->proc[i]->priority;
-                    index = i;
-                }
+            q->keys = malloc (sizeof (unsigned long long)
+                              * (q->cap ? q->cap : QUEUE_INIT_CAP));
+            if (q->keys == NULL)
+                return -1;
+            if (q->cap == 0 && queue_grow (q) != 0)
+                return -1;
         }
+    if (q->size == q->cap && queue_grow (q) != 0)
+        return -1;
+
+    q->proc[q->size] = proc;
+    /* The arrival number breaks ties, so equal keys leave in FIFO order */
+    q->keys[q->size] = ((unsigned long long)key << 32) | q->seq++;
+    q->size++;
+    heap_sift_up (q, q->size - 1);
+    return 0;
+}
+
+struct pcb_t *
+dequeue_prio (struct queue_t *q)
+{
+    if (empty (q))
+        return NULL;
+
+    struct pcb_t *proc = q->proc[0];
+    q->size--;
+    q->proc[0] = q->proc[q->size];
+    q->keys[0] = q->keys[q->size];
+    heap_sift_down (q, 0);
+    return proc;
+}
 
-    return index;
+struct pcb_t *
+peek_prio (struct queue_t *q)
+{
+    return empty (q) ? NULL : q->proc[0];
 }
 
 struct pcb_t *
@@ -55,48 +180,91 @@ dequeue (struct queue_t *q)
 
     if (!empty (q))
         {
-            struct pcb_t *newProc = malloc (sizeof (struct pcb_t));
-            newProc = q->proc[0];
-            for (int i = 0; i < q->size; i++)
-                {
-                    q->proc[i] = q->proc[i + 1];
-                }
+            struct pcb_t *newProc = q->proc[0];
+            q->head = (q->head + 1) & (q->cap - 1);
+            q->proc = q->buf + q->head;
             q->size--;
             return newProc;
         }
 
 #else
-    if (!empty (q))
-        {
-            int index = queuePeek (q);
-            struct pcb_t *newProc = malloc (sizeof (struct pcb_t));
-            newProc = q->proc[index];
-            for (int i = index; i < q->size; i++)
-                {
-                    q->proc[i] = q->proc[i + 1];
-                }
-            q->size--;
-            return newProc;
-        }
+    return dequeue_prio (q);
 #endif
     return NULL;
 }
 
+struct pcb_t *
+dequeue_affine (struct queue_t *q, int cpu, int lookahead)
+{
+    struct pcb_t *proc;
+    int i;
+
+    if (empty (q))
+        return NULL;
+#ifndef MLQ_SCHED
+    lookahead = 0; // heap order, there is no FIFO front to look behind
+#endif
+    if (q->proc[0] == q->passed) // its turn has come already
+        lookahead = 0;
+    if (lookahead > q->size)
+        lookahead = q->size;
+    for (i = 0; i < lookahead; i++)
+        if (q->proc[i]->last_cpu == cpu)
+            break;
+    if (i == lookahead || i == 0)
+        return dequeue (q);
+
+    /* Shift the i processes before it one step to the rear, then drop the
+     * front as dequeue() does */
+    q->passed = q->proc[0];
+    proc = q->proc[i];
+    for (; i > 0; i--)
+        queue_set (q, i, q->proc[i - 1]);
+    q->head = (q->head + 1) & (q->cap - 1);
+    q->proc = q->buf + q->head;
+    q->size--;
+    return proc;
+}
+
+struct pcb_t *
+dequeue_tail (struct queue_t *q)
+{
+    if (empty (q))
+        return NULL;
+    q->size--;
+    return q->proc[q->size];
+}
+
 /* Heap-allocate the queue, and initialize its attributes*/
 struct queue_t *
 init_queue ()
 {
     /* The name should be changed to `ptr` to avoid confusion
         of using the global variable */
-    struct queue_t *ptr = malloc (sizeof (struct queue_t));
-    ptr->size = 0;
+    struct queue_t *ptr = calloc (1, sizeof (struct queue_t));
     return ptr;
 };
 
+/* Reclaim the storage of the queue, but not the queue itself */
+void
+release_queue (struct queue_t *q)
+{
+    free (q->buf);
+    free (q->keys);
+    q->buf = NULL;
+    q->keys = NULL;
+    q->proc = NULL;
+    q->passed = NULL;
+    q->cap = 0;
+    q->head = 0;
+    q->size = 0;
+}
+
 /* Reclaim the heap-allocation of the queue */
 void
 destroy_queue (struct queue_t *q)
 {
+    release_queue (q);
     q->size = -1; // To signify that this queue is invalid
                   // Later access to this 'garbage value' can be debugged
                   // easier
@@ -0,0 +1,263 @@
+/**
+ * @file rbtree.c
+ * @category Implementation source code
+ * @brief
+ *      Implementation from `rbtree.h` interface. The fix-ups follow
+ * Cormen et al., with NULL children standing for the black leaves.
+ */
+#include "rbtree.h"
+
+static inline int
+is_red (const struct rb_node_t *node)
+{
+    return node != NULL && node->color == RB_RED;
+}
+
+/* Put `v` in place of `u` under the parent of `u` */
+static void
+rb_transplant (struct rb_tree_t *tree, struct rb_node_t *u,
+               struct rb_node_t *v)
+{
+    if (u->parent == NULL)
+        tree->root = v;
+    else if (u == u->parent->left)
+        u->parent->left = v;
+    else
+        u->parent->right = v;
+    if (v != NULL)
+        v->parent = u->parent;
+}
+
+static void
+rb_rotate_left (struct rb_tree_t *tree, struct rb_node_t *x)
+{
+    struct rb_node_t *y = x->right;
+    x->right = y->left;
+    if (y->left != NULL)
+        y->left->parent = x;
+    rb_transplant (tree, x, y);
+    y->left = x;
+    x->parent = y;
+}
+
+static void
+rb_rotate_right (struct rb_tree_t *tree, struct rb_node_t *x)
+{
+    struct rb_node_t *y = x->left;
+    x->left = y->right;
+    if (y->right != NULL)
+        y->right->parent = x;
+    rb_transplant (tree, x, y);
+    y->right = x;
+    x->parent = y;
+}
+
+void
+rb_insert (struct rb_tree_t *tree, struct rb_node_t *node,
+           int (*less) (const struct rb_node_t *, const struct rb_node_t *))
+{
+    struct rb_node_t **link = &tree->root;
+    struct rb_node_t *parent = NULL;
+    int leftmost = 1;
+
+    while (*link != NULL)
+        {
+            parent = *link;
+            if (less (node, parent))
+                link = &parent->left;
+            else
+                {
+                    link = &parent->right;
+                    leftmost = 0;
+                }
+        }
+    node->parent = parent;
+    node->left = node->right = NULL;
+    node->color = RB_RED;
+    *link = node;
+    if (leftmost)
+        tree->leftmost = node;
+
+    /* A red node under a red parent: recolor or rotate upwards */
+    while (is_red (node->parent))
+        {
+            struct rb_node_t *p = node->parent;
+            struct rb_node_t *g = p->parent; // exists, the root is black
+            if (p == g->left)
+                {
+                    struct rb_node_t *uncle = g->right;
+                    if (is_red (uncle))
+                        {
+                            p->color = uncle->color = RB_BLACK;
+                            g->color = RB_RED;
+                            node = g;
+                            continue;
+                        }
+                    if (node == p->right)
+                        {
+                            rb_rotate_left (tree, p);
+                            p = node;
+                        }
+                    p->color = RB_BLACK;
+                    g->color = RB_RED;
+                    rb_rotate_right (tree, g);
+                    break; // p took the place of g, and is black
+                }
+            else
+                {
+                    struct rb_node_t *uncle = g->left;
+                    if (is_red (uncle))
+                        {
+                            p->color = uncle->color = RB_BLACK;
+                            g->color = RB_RED;
+                            node = g;
+                            continue;
+                        }
+                    if (node == p->left)
+                        {
+                            rb_rotate_right (tree, p);
+                            p = node;
+                        }
+                    p->color = RB_BLACK;
+                    g->color = RB_RED;
+                    rb_rotate_left (tree, g);
+                    break; // p took the place of g, and is black
+                }
+        }
+    tree->root->color = RB_BLACK;
+}
+
+/* `x` (maybe NULL, then a leaf of `parent`) lacks one black */
+static void
+rb_erase_fixup (struct rb_tree_t *tree, struct rb_node_t *x,
+                struct rb_node_t *parent)
+{
+    while (x != tree->root && !is_red (x))
+        {
+            struct rb_node_t *w;
+            if (x == parent->left)
+                {
+                    w = parent->right;
+                    if (is_red (w))
+                        {
+                            w->color = RB_BLACK;
+                            parent->color = RB_RED;
+                            rb_rotate_left (tree, parent);
+                            w = parent->right;
+                        }
+                    if (!is_red (w->left) && !is_red (w->right))
+                        {
+                            w->color = RB_RED;
+                            x = parent;
+                            parent = x->parent;
+                            continue;
+                        }
+                    if (!is_red (w->right))
+                        {
+                            w->left->color = RB_BLACK;
+                            w->color = RB_RED;
+                            rb_rotate_right (tree, w);
+                            w = parent->right;
+                        }
+                    w->color = parent->color;
+                    parent->color = RB_BLACK;
+                    w->right->color = RB_BLACK;
+                    rb_rotate_left (tree, parent);
+                }
+            else
+                {
+                    w = parent->left;
+                    if (is_red (w))
+                        {
+                            w->color = RB_BLACK;
+                            parent->color = RB_RED;
+                            rb_rotate_right (tree, parent);
+                            w = parent->left;
+                        }
+                    if (!is_red (w->left) && !is_red (w->right))
+                        {
+                            w->color = RB_RED;
+                            x = parent;
+                            parent = x->parent;
+                            continue;
+                        }
+                    if (!is_red (w->left))
+                        {
+                            w->right->color = RB_BLACK;
+                            w->color = RB_RED;
+                            rb_rotate_left (tree, w);
+                            w = parent->left;
+                        }
+                    w->color = parent->color;
+                    parent->color = RB_BLACK;
+                    w->left->color = RB_BLACK;
+                    rb_rotate_right (tree, parent);
+                }
+            x = tree->root;
+        }
+    if (x != NULL)
+        x->color = RB_BLACK;
+}
+
+void
+rb_erase (struct rb_tree_t *tree, struct rb_node_t *node)
+{
+    struct rb_node_t *x, *parent;
+    int removed_color = node->color;
+
+    if (tree->leftmost == node)
+        tree->leftmost = rb_next (node);
+
+    if (node->left == NULL)
+        {
+            x = node->right;
+            parent = node->parent;
+            rb_transplant (tree, node, node->right);
+        }
+    else if (node->right == NULL)
+        {
+            x = node->left;
+            parent = node->parent;
+            rb_transplant (tree, node, node->left);
+        }
+    else
+        {
+            /* Replace `node` by its successor `y`, the least of its right */
+            struct rb_node_t *y = node->right;
+            while (y->left != NULL)
+                y = y->left;
+            removed_color = y->color;
+            x = y->right;
+            if (y->parent == node)
+                parent = y;
+            else
+                {
+                    parent = y->parent;
+                    rb_transplant (tree, y, y->right);
+                    y->right = node->right;
+                    y->right->parent = y;
+                }
+            rb_transplant (tree, node, y);
+            y->left = node->left;
+            y->left->parent = y;
+            y->color = node->color;
+        }
+
+    if (removed_color == RB_BLACK)
+        rb_erase_fixup (tree, x, parent);
+}
+
+struct rb_node_t *
+rb_next (const struct rb_node_t *node)
+{
+    if (node->right != NULL)
+        {
+            node = node->right;
+            while (node->left != NULL)
+                node = node->left;
+            return (struct rb_node_t *)node;
+        }
+    while (node->parent != NULL && node == node->parent->right)
+        node = node->parent;
+    return node->parent;
+}
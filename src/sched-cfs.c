@@ -0,0 +1,333 @@
+/**
+ * @file sched-cfs.c
+ * @category Implementation source code
+ * @brief
+ *      Completely fair scheduler (CFS) policy.
+ *
+ *      Every CPU keeps its ready processes in a red-black tree sorted by
+ * virtual runtime, and always dispatches the leftmost one. A process of
+ * priority `prio` weighs MAX_PRIO - prio, the same share the MLQ gives it
+ * in slots. Its vruntime grows by CFS_VRUNTIME_UNIT / weight per slot it
+ * runs, so the heavier the process the slower its clock. The quantum comes
+ * from a target latency instead of the global time slot.
+ */
+#include "sched-class.h"
+#include <pthread.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CFS_VRUNTIME_UNIT ((uint64_t)MAX_PRIO << 10)
+#define CFS_WEIGHT(proc) (MAX_PRIO - (proc)->prio)
+
+/**
+ * @brief
+ *      CFS run queue, owned by one CPU.
+ *
+ *  tasks        : ready processes, sorted by vruntime. Equal vruntimes are
+ *                 kept in FIFO order.
+ *  min_vruntime : monotonic lower bound of the vruntimes on this CPU. New
+ *                 and migrated processes are placed relative to it.
+ *  load         : sum of the weights of the processes in `tasks`.
+ *  curr         : the process running on this CPU, NULL if idle.
+ *
+ * @note
+ *      Everything but `nr_queued` is protected by `lock`.
+ */
+struct cfs_rq_t
+{
+    pthread_mutex_t lock;
+    struct rb_tree_t tasks;
+    uint64_t min_vruntime;
+    unsigned long load;
+    struct pcb_t *curr;
+    int nr_queued;
+};
+
+static struct cfs_rq_t *cfs_rq = NULL; // One CFS run queue per CPU
+static unsigned long cfs_nr_stolen = 0;
+
+static int
+cfs_less (const struct rb_node_t *a, const struct rb_node_t *b)
+{
+    return rb_entry (a, struct pcb_t, run_node)->vruntime
+           < rb_entry (b, struct pcb_t, run_node)->vruntime;
+}
+
+static int
+cfs_nr_queued (int cpu)
+{
+    return __atomic_load_n (&cfs_rq[cpu].nr_queued, __ATOMIC_RELAXED);
+}
+
+static void
+cfs_account (struct cfs_rq_t *rq, int delta)
+{
+    __atomic_add_fetch (&rq->nr_queued, delta, __ATOMIC_RELAXED);
+    sched_account (delta);
+}
+
+/* Link `proc` into the tree of `rq`, whose lock must be held */
+static void
+cfs_enqueue (struct cfs_rq_t *rq, struct pcb_t *proc)
+{
+    rb_insert (&rq->tasks, &proc->run_node, cfs_less);
+    rq->load += CFS_WEIGHT (proc);
+    cfs_account (rq, 1);
+}
+
+/* Unlink the leftmost process of `rq`, whose lock must be held */
+static struct pcb_t *
+cfs_dequeue_first (struct cfs_rq_t *rq)
+{
+    struct rb_node_t *node = rb_first (&rq->tasks);
+    struct pcb_t *proc;
+
+    if (node == NULL)
+        return NULL;
+    proc = rb_entry (node, struct pcb_t, run_node);
+    rb_erase (&rq->tasks, node);
+    rq->load -= CFS_WEIGHT (proc);
+    cfs_account (rq, -1);
+    return proc;
+}
+
+/* Move min_vruntime up to the least vruntime on `rq`, never backwards */
+static void
+cfs_update_min_vruntime (struct cfs_rq_t *rq)
+{
+    struct rb_node_t *first = rb_first (&rq->tasks);
+    uint64_t vruntime;
+
+    if (rq->curr != NULL)
+        {
+            vruntime = rq->curr->vruntime;
+            if (first != NULL
+                && rb_entry (first, struct pcb_t, run_node)->vruntime
+                       < vruntime)
+                vruntime = rb_entry (first, struct pcb_t, run_node)->vruntime;
+        }
+    else if (first != NULL)
+        vruntime = rb_entry (first, struct pcb_t, run_node)->vruntime;
+    else
+        return;
+    if (vruntime > rq->min_vruntime)
+        rq->min_vruntime = vruntime;
+}
+
+static void
+cfs_init (int num_cpus)
+{
+    int i;
+
+    cfs_rq = calloc (num_cpus, sizeof (struct cfs_rq_t));
+    for (i = 0; i < num_cpus; i++)
+        pthread_mutex_init (&cfs_rq[i].lock, NULL);
+    cfs_nr_stolen = 0;
+}
+
+static void
+cfs_finish (void)
+{
+    int i;
+
+    for (i = 0; i < sched_nr_cpus; i++)
+        pthread_mutex_destroy (&cfs_rq[i].lock);
+    free (cfs_rq);
+    cfs_rq = NULL;
+}
+
+/**
+ * @brief
+ *      Steal a process for the idle CPU `thief`, from the CPU with the most
+ * queued processes. We take the leftmost one, which has waited the most for
+ * its fair share. Its lag behind the victim's min_vruntime is kept on the
+ * thief, so that it is neither favored nor penalized by the migration.
+ */
+static struct pcb_t *
+steal_cfs_proc (struct cfs_rq_t *thief)
+{
+    struct cfs_rq_t *victim = NULL;
+    struct pcb_t *proc;
+    uint64_t lag = 0;
+    int max_queued = 0;
+    int i;
+
+    for (i = 0; i < sched_nr_cpus; i++)
+        {
+            int queued = cfs_nr_queued (i);
+            if (&cfs_rq[i] != thief && queued > max_queued)
+                {
+                    max_queued = queued;
+                    victim = &cfs_rq[i];
+                }
+        }
+    if (victim == NULL)
+        return NULL;
+
+    pthread_mutex_lock (&victim->lock);
+    proc = cfs_dequeue_first (victim);
+    if (proc != NULL && proc->vruntime > victim->min_vruntime)
+        lag = proc->vruntime - victim->min_vruntime;
+    pthread_mutex_unlock (&victim->lock);
+
+    if (proc != NULL)
+        {
+            pthread_mutex_lock (&thief->lock);
+            proc->vruntime = thief->min_vruntime + lag;
+            thief->curr = proc;
+            pthread_mutex_unlock (&thief->lock);
+            __atomic_add_fetch (&cfs_nr_stolen, 1, __ATOMIC_RELAXED);
+        }
+    return proc;
+}
+
+/* Dispatch the process with the least vruntime, or steal one */
+static struct pcb_t *
+cfs_pick_next (int cpu)
+{
+    struct cfs_rq_t *rq = &cfs_rq[cpu];
+    struct pcb_t *proc;
+
+    pthread_mutex_lock (&rq->lock);
+    proc = cfs_dequeue_first (rq);
+    rq->curr = proc;
+    cfs_update_min_vruntime (rq);
+    pthread_mutex_unlock (&rq->lock);
+
+    if (proc == NULL)
+        proc = steal_cfs_proc (rq);
+    return proc;
+}
+
+/**
+ * @brief
+ *      Put `proc` back to the tree of `cpu`. A new process starts at the
+ * min_vruntime of its CPU: it gets its fair share from now on, but no
+ * credit for the time it did not exist.
+ */
+static void
+cfs_enqueue_proc (int cpu, struct pcb_t *proc)
+{
+    struct cfs_rq_t *rq;
+
+    if (proc->prio >= MAX_PRIO)
+        return;
+
+    if (cpu == SCHED_NEW_PROC)
+        {
+            rq = &cfs_rq[sched_pick_cpu (cfs_nr_queued)];
+            pthread_mutex_lock (&rq->lock);
+            if (proc->vruntime < rq->min_vruntime)
+                proc->vruntime = rq->min_vruntime;
+        }
+    else
+        {
+            rq = &cfs_rq[cpu];
+            pthread_mutex_lock (&rq->lock);
+            if (rq->curr == proc)
+                rq->curr = NULL;
+        }
+    cfs_enqueue (rq, proc);
+    pthread_mutex_unlock (&rq->lock);
+}
+
+/**
+ * @brief
+ *      The ready processes of a CPU share CFS_TARGET_LATENCY by weight: the
+ * more processes wait, the shorter the quantum, down to CFS_MIN_GRANULARITY
+ * so that the switches do not eat all the slots.
+ */
+static int
+cfs_time_slice (int cpu, struct pcb_t *proc, int time_slot)
+{
+    struct cfs_rq_t *rq = &cfs_rq[cpu];
+    unsigned long weight = CFS_WEIGHT (proc);
+    unsigned long slice;
+
+    pthread_mutex_lock (&rq->lock);
+    slice = CFS_TARGET_LATENCY * weight / (rq->load + weight);
+    pthread_mutex_unlock (&rq->lock);
+    return slice < CFS_MIN_GRANULARITY ? CFS_MIN_GRANULARITY : slice;
+}
+
+static void
+cfs_on_tick (int cpu, struct pcb_t *proc,
+             uint64_t now __attribute__ ((unused)))
+{
+    struct cfs_rq_t *rq = &cfs_rq[cpu];
+
+    pthread_mutex_lock (&rq->lock);
+    proc->vruntime += CFS_VRUNTIME_UNIT / CFS_WEIGHT (proc);
+    cfs_update_min_vruntime (rq);
+    pthread_mutex_unlock (&rq->lock);
+}
+
+static void
+cfs_on_exit (int cpu, struct pcb_t *proc)
+{
+    struct cfs_rq_t *rq = &cfs_rq[cpu];
+
+    pthread_mutex_lock (&rq->lock);
+    if (rq->curr == proc)
+        rq->curr = NULL;
+    pthread_mutex_unlock (&rq->lock);
+}
+
+/**
+ * @brief
+ *      Move the tree of the offline `cpu` to the online CPUs. Like a stolen
+ * process, each keeps its lag behind the min_vruntime of its CPU.
+ */
+static int
+cfs_migrate (int cpu)
+{
+    struct cfs_rq_t *rq = &cfs_rq[cpu];
+    struct cfs_rq_t *dest;
+    struct pcb_t *proc;
+    uint64_t lag;
+    int moved = 0;
+
+    while (1)
+        {
+            lag = 0;
+            pthread_mutex_lock (&rq->lock);
+            proc = cfs_dequeue_first (rq);
+            if (proc != NULL && proc->vruntime > rq->min_vruntime)
+                lag = proc->vruntime - rq->min_vruntime;
+            pthread_mutex_unlock (&rq->lock);
+            if (proc == NULL)
+                return moved;
+
+            dest = &cfs_rq[sched_pick_cpu (cfs_nr_queued)];
+            pthread_mutex_lock (&dest->lock);
+            proc->vruntime = dest->min_vruntime + lag;
+            cfs_enqueue (dest, proc);
+            pthread_mutex_unlock (&dest->lock);
+            moved++;
+        }
+}
+
+static void
+cfs_stats (void)
+{
+    int i;
+
+    printf ("CFS: %lu processes stolen\n", cfs_nr_stolen);
+    for (i = 0; i < sched_nr_cpus; i++)
+        printf ("\tCPU %d: min_vruntime %lu\n", i,
+                (unsigned long)cfs_rq[i].min_vruntime);
+}
+
+const struct sched_class_t cfs_sched_class = {
+    .name = "cfs",
+    .init = cfs_init,
+    .finish = cfs_finish,
+    .enqueue = cfs_enqueue_proc,
+    .pick_next = cfs_pick_next,
+    .time_slice = cfs_time_slice,
+    .on_tick = cfs_on_tick,
+    .on_exit = cfs_on_exit,
+    .stats = cfs_stats,
+    .migrate = cfs_migrate,
+};
@@ -0,0 +1,233 @@
+/**
+ * @file sched-mlfq.c
+ * @category Implementation source code
+ * @brief
+ *      Multi-level feedback queue (MLFQ) policy: the level of a process is
+ * learnt from its behavior, instead of the fixed `prio` of the loader.
+ *
+ *      Every process starts at level 0, the highest. Once it has run for the
+ * whole quantum of its level, in one go or in pieces, it is demoted one
+ * level, where the quantum is longer. A process giving the CPU back early
+ * stays where it is. Every MLFQ_BOOST_PERIOD slots, all processes are
+ * moved back to level 0, so that the low levels do not starve.
+ *
+ *      The levels are FIFO queues shared by all CPUs. The quantum of level
+ * `l` is `time_slot << l` by default, or the table given to
+ * sched_set_mlfq_quanta().
+ */
+#include "queue.h"
+#include "sched-class.h"
+#include "sched.h"
+#include <pthread.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * @brief
+ *      State of the MLFQ, protected by `mlfq_lock`.
+ *
+ *  epoch : number of boosts so far. A process whose `mlfq_epoch` is older
+ *          was running during a boost, and goes back to level 0.
+ *  ticks : slots of the simulation so far, the clock of the boosts. The
+ *          CPUs running in the same slot count it once.
+ */
+static struct queue_t mlfq_ready[MLFQ_MAX_LEVELS];
+static pthread_mutex_t mlfq_lock;
+static uint32_t mlfq_epoch = 0;
+static unsigned long mlfq_ticks = 0;
+static unsigned long mlfq_last_boost = 0;
+
+/* Quanta table, set from the configure file. 0 levels means the default */
+static int mlfq_quanta[MLFQ_MAX_LEVELS];
+static int mlfq_nr_quanta = 0;
+static int mlfq_time_slot = 1; // the global time slot, for the default
+
+static unsigned long mlfq_nr_demoted = 0;
+static unsigned long mlfq_nr_boosts = 0;
+static unsigned long mlfq_nr_dispatched[MLFQ_MAX_LEVELS];
+
+static int
+mlfq_nr_levels (void)
+{
+    return mlfq_nr_quanta ? mlfq_nr_quanta : MLFQ_LEVELS;
+}
+
+static int
+mlfq_quantum (int level)
+{
+    return mlfq_nr_quanta ? mlfq_quanta[level] : mlfq_time_slot << level;
+}
+
+int
+sched_set_mlfq_quanta (const int *quanta, int n)
+{
+    int i;
+
+    if (n <= 0 || n > MLFQ_MAX_LEVELS)
+        return -1;
+    for (i = 0; i < n; i++)
+        if (quanta[i] <= 0)
+            return -1;
+    for (i = 0; i < n; i++)
+        mlfq_quanta[i] = quanta[i];
+    mlfq_nr_quanta = n;
+    return 0;
+}
+
+static void
+mlfq_init (int num_cpus)
+{
+    int level;
+
+    pthread_mutex_init (&mlfq_lock, NULL);
+    mlfq_epoch = 0;
+    mlfq_ticks = mlfq_last_boost = 0;
+    mlfq_nr_demoted = mlfq_nr_boosts = 0;
+    for (level = 0; level < MLFQ_MAX_LEVELS; level++)
+        mlfq_nr_dispatched[level] = 0;
+}
+
+static void
+mlfq_finish (void)
+{
+    int level;
+
+    for (level = 0; level < MLFQ_MAX_LEVELS; level++)
+        release_queue (&mlfq_ready[level]);
+    pthread_mutex_destroy (&mlfq_lock);
+}
+
+/**
+ * @brief
+ *      Move every queued process back to level 0, with a whole quantum
+ * there, `mlfq_lock` must be held. They join the new epoch, so that their
+ * next put-back demotes them as usual.
+ */
+static void
+mlfq_boost (void)
+{
+    struct pcb_t *proc;
+    int level, i;
+
+    mlfq_epoch++;
+    for (i = 0; i < mlfq_ready[0].size; i++)
+        {
+            mlfq_ready[0].proc[i]->mlfq_ran = 0;
+            mlfq_ready[0].proc[i]->mlfq_epoch = mlfq_epoch;
+        }
+    for (level = 1; level < mlfq_nr_levels (); level++)
+        while ((proc = dequeue (&mlfq_ready[level])) != NULL)
+            {
+                proc->mlfq_level = 0;
+                proc->mlfq_ran = 0;
+                proc->mlfq_epoch = mlfq_epoch;
+                if (enqueue (&mlfq_ready[0], proc) != 0)
+                    {
+                        printf ("Error: in sched-mlfq.c / mlfq_boost() :\n");
+                        printf ("Can not grow the ready queue.\n");
+                        exit (1);
+                    }
+            }
+    mlfq_last_boost = mlfq_ticks;
+    mlfq_nr_boosts++;
+}
+
+/**
+ * @brief
+ *      Put `proc` back to its level, after demoting it if it has used up its
+ * quantum there. A new process starts at level 0.
+ */
+static void
+mlfq_enqueue (int cpu, struct pcb_t *proc)
+{
+    pthread_mutex_lock (&mlfq_lock);
+    if (cpu == SCHED_NEW_PROC || proc->mlfq_epoch != mlfq_epoch)
+        {
+            proc->mlfq_level = 0;
+            proc->mlfq_ran = 0;
+            proc->mlfq_epoch = mlfq_epoch;
+        }
+    else if (proc->mlfq_ran >= (uint32_t)mlfq_quantum (proc->mlfq_level)
+             && (int)proc->mlfq_level < mlfq_nr_levels () - 1)
+        {
+            proc->mlfq_level++;
+            proc->mlfq_ran = 0;
+            mlfq_nr_demoted++;
+        }
+    if (enqueue (&mlfq_ready[proc->mlfq_level], proc) != 0)
+        {
+            printf ("Error: in sched-mlfq.c / mlfq_enqueue() :\n");
+            printf ("Can not grow the ready queue.\n");
+            exit (1);
+        }
+    sched_account (1);
+    pthread_mutex_unlock (&mlfq_lock);
+}
+
+static struct pcb_t *
+mlfq_pick_next (int cpu)
+{
+    struct pcb_t *proc = NULL;
+    int level;
+
+    pthread_mutex_lock (&mlfq_lock);
+    if (mlfq_ticks - mlfq_last_boost >= MLFQ_BOOST_PERIOD)
+        mlfq_boost ();
+    for (level = 0; level < mlfq_nr_levels () && proc == NULL; level++)
+        proc = dequeue_affine (&mlfq_ready[level], cpu,
+                               SCHED_AFFINITY_LOOKAHEAD);
+    if (proc != NULL)
+        {
+            sched_account (-1);
+            mlfq_nr_dispatched[level - 1]++;
+        }
+    pthread_mutex_unlock (&mlfq_lock);
+    return proc;
+}
+
+/* The rest of the quantum of the level of `proc` */
+static int
+mlfq_time_slice (int cpu, struct pcb_t *proc, int time_slot)
+{
+    int quantum;
+
+    pthread_mutex_lock (&mlfq_lock);
+    mlfq_time_slot = time_slot;
+    quantum = mlfq_quantum (proc->mlfq_level) - proc->mlfq_ran;
+    pthread_mutex_unlock (&mlfq_lock);
+    return quantum > 0 ? quantum : 1;
+}
+
+static void
+mlfq_on_tick (int cpu, struct pcb_t *proc, uint64_t now)
+{
+    pthread_mutex_lock (&mlfq_lock);
+    proc->mlfq_ran++;
+    if (now >= mlfq_ticks)
+        mlfq_ticks = now + 1;
+    pthread_mutex_unlock (&mlfq_lock);
+}
+
+static void
+mlfq_stats (void)
+{
+    int level;
+
+    printf ("MLFQ: %lu demotions, %lu boosts\n", mlfq_nr_demoted,
+            mlfq_nr_boosts);
+    for (level = 0; level < mlfq_nr_levels (); level++)
+        printf ("\tLevel %d: quantum %d, %lu dispatches\n", level,
+                mlfq_quantum (level), mlfq_nr_dispatched[level]);
+}
+
+const struct sched_class_t mlfq_sched_class = {
+    .name = "mlfq",
+    .init = mlfq_init,
+    .finish = mlfq_finish,
+    .enqueue = mlfq_enqueue,
+    .pick_next = mlfq_pick_next,
+    .time_slice = mlfq_time_slice,
+    .on_tick = mlfq_on_tick,
+    .stats = mlfq_stats,
+};
@@ -0,0 +1,87 @@
+/**
+ * @file sched-prio.c
+ * @category Implementation source code
+ * @brief
+ *      Plain priority policy: one ready queue shared by all CPUs, always
+ * dispatching the process with the least `prio`. Equal priorities are
+ * served in FIFO order, and every process runs a whole time slot.
+ */
+#include "queue.h"
+#include "sched-class.h"
+#include <pthread.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static struct queue_t prio_ready; // Binary min-heap on prio
+static pthread_mutex_t prio_lock;
+static unsigned long prio_nr_dispatched = 0;
+
+static void
+prio_init (int num_cpus)
+{
+    pthread_mutex_init (&prio_lock, NULL);
+    prio_nr_dispatched = 0;
+}
+
+static void
+prio_finish (void)
+{
+    release_queue (&prio_ready);
+    pthread_mutex_destroy (&prio_lock);
+}
+
+static void
+prio_enqueue (int cpu, struct pcb_t *proc)
+{
+    if (proc->prio >= MAX_PRIO)
+        return;
+
+    pthread_mutex_lock (&prio_lock);
+    if (enqueue_prio (&prio_ready, proc, proc->prio) != 0)
+        {
+            printf ("Error: in sched-prio.c / prio_enqueue() :\n");
+            printf ("Can not grow the ready queue.\n");
+            exit (1);
+        }
+    sched_account (1);
+    pthread_mutex_unlock (&prio_lock);
+}
+
+static struct pcb_t *
+prio_pick_next (int cpu)
+{
+    struct pcb_t *proc;
+
+    pthread_mutex_lock (&prio_lock);
+    proc = dequeue_prio (&prio_ready);
+    if (proc != NULL)
+        {
+            sched_account (-1);
+            prio_nr_dispatched++;
+        }
+    pthread_mutex_unlock (&prio_lock);
+    return proc;
+}
+
+static int
+prio_rank (struct pcb_t *proc)
+{
+    return proc->prio;
+}
+
+static void
+prio_stats (void)
+{
+    printf ("PRIO: %lu dispatches\n", prio_nr_dispatched);
+}
+
+const struct sched_class_t prio_sched_class = {
+    .name = "prio",
+    .init = prio_init,
+    .finish = prio_finish,
+    .enqueue = prio_enqueue,
+    .pick_next = prio_pick_next,
+    .stats = prio_stats,
+    .rank = prio_rank,
+};
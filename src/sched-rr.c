@@ -0,0 +1,77 @@
+/**
+ * @file sched-rr.c
+ * @category Implementation source code
+ * @brief
+ *      Round-robin policy: one FIFO ready queue shared by all CPUs. The
+ * priorities are ignored, every process runs a whole time slot in turn,
+ * but a CPU may pick a process it ran last among the first few in line.
+ */
+#include "queue.h"
+#include "sched-class.h"
+#include <pthread.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static struct queue_t rr_ready;
+static pthread_mutex_t rr_lock;
+static unsigned long rr_nr_dispatched = 0;
+
+static void
+rr_init (int num_cpus)
+{
+    pthread_mutex_init (&rr_lock, NULL);
+    rr_nr_dispatched = 0;
+}
+
+static void
+rr_finish (void)
+{
+    release_queue (&rr_ready);
+    pthread_mutex_destroy (&rr_lock);
+}
+
+static void
+rr_enqueue (int cpu, struct pcb_t *proc)
+{
+    pthread_mutex_lock (&rr_lock);
+    if (enqueue (&rr_ready, proc) != 0)
+        {
+            printf ("Error: in sched-rr.c / rr_enqueue() :\n");
+            printf ("Can not grow the ready queue.\n");
+            exit (1);
+        }
+    sched_account (1);
+    pthread_mutex_unlock (&rr_lock);
+}
+
+static struct pcb_t *
+rr_pick_next (int cpu)
+{
+    struct pcb_t *proc;
+
+    pthread_mutex_lock (&rr_lock);
+    proc = dequeue_affine (&rr_ready, cpu, SCHED_AFFINITY_LOOKAHEAD);
+    if (proc != NULL)
+        {
+            sched_account (-1);
+            rr_nr_dispatched++;
+        }
+    pthread_mutex_unlock (&rr_lock);
+    return proc;
+}
+
+static void
+rr_stats (void)
+{
+    printf ("RR: %lu dispatches\n", rr_nr_dispatched);
+}
+
+const struct sched_class_t rr_sched_class = {
+    .name = "rr",
+    .init = rr_init,
+    .finish = rr_finish,
+    .enqueue = rr_enqueue,
+    .pick_next = rr_pick_next,
+    .stats = rr_stats,
+};
@@ -12,6 +12,12 @@
  *      put_proc() push back the residual process back to the queue of same
  * priority.
  *
+ *      The MLQ is one of several policies: the scheduler interface (sched.h)
+ * dispatches to the sched_class_t chosen by init_scheduler_policy(), among
+ * `sched_classes` below. The other policies live in sched-*.c.
+ *
+ *      Processes with a deadline bypass the policy: they are kept by the
+ * earliest deadline first (EDF) class below, and always dispatched first.
  *
  * @note
  *      We distinguish MLQ (a set of queues) and queue (a normal FIFO priority
@@ -22,166 +28,535 @@
  *      carefully and decide which should not be implemented. NK purposefully
  * mark not useful declarations as deprecated. (both as comments and as macros)
  *
- * @warning
- *      Group discussion required to decide whether we should use ready_queue
- * or not (to make sure that our OS runs fine on both MLQ and single-queue).
- *
  */
 #include "sched.h"
+#include "bitops.h"
 #include "queue.h"
+#include "sched-class.h"
+#ifdef MLQ_LOCKFREE
+#include "mpmc.h"
+#endif
 #include <pthread.h>
 
 #include <stdio.h>
 #include <stdlib.h>
-__attribute__ ((deprecated)) static struct queue_t ready_queue; // DEPRECATED
-__attribute__ ((deprecated)) static struct queue_t run_queue;   // DEPRECATED
-static pthread_mutex_t queue_lock;
-static int current_prio = 0;
-
-#ifdef MLQ_SCHED
-/* Define an array of queues */
-static struct queue_t mlq_ready_queue[MAX_PRIO];
+#include <string.h>
+
+/* Registered policies, the first one is the default */
+static const struct sched_class_t *sched_classes[]
+    = { &mlq_sched_class, &cfs_sched_class, &mlfq_sched_class,
+        &prio_sched_class, &rr_sched_class, NULL };
+
+static const struct sched_class_t *sched_class = &mlq_sched_class;
+int sched_nr_cpus = 0;
+static int sched_nr_queued = 0; // Processes queued by the policy
+static int sched_next_cpu = 0;  // Where sched_pick_cpu() starts looking
+static unsigned long sched_nr_affine = 0;   // Dispatches on the last CPU
+static unsigned long sched_nr_migrated = 0; // Dispatches on another CPU
+
+/*
+ * Arrival-triggered preemption. sched_cpu_rank[cpu] is the rank of the
+ * process running on `cpu`, SCHED_RANK_IDLE if it runs none, and
+ * SCHED_RANK_NONE if it can not be preempted. add_proc() raises
+ * sched_resched[cpu] for the CPU to put its process back.
+ */
+#define SCHED_RANK_IDLE -2
+#define SCHED_RANK_NONE -1
+static int *sched_cpu_rank = NULL;
+static int *sched_resched = NULL;
+static unsigned long sched_nr_preempted = 0;
+
+/*
+ * Idle CPUs park in `sched_idle_mask`, bit `cpu` of word `cpu / bits`, and
+ * do not look into the ready queues until an enqueue clears their bit.
+ */
+static unsigned long *sched_idle_mask = NULL;
+static unsigned long sched_nr_parked = 0;
+static unsigned long sched_nr_woken = 0;
+
+/*
+ * CPUs brought online and offline at run time, see sched_set_online(). The
+ * flags only change at slot boundaries, they are read without a lock.
+ */
+static int *sched_cpu_online = NULL;
+static int sched_nr_online = 0;
+static unsigned long sched_nr_onlined = 0;
+static unsigned long sched_nr_offlined = 0;
+static unsigned long sched_nr_moved = 0; // processes of offline CPUs
+
+#define MLQ_BITS_PER_WORD (BITS_PER_BYTE * sizeof (unsigned long))
+#define MLQ_BITMAP_WORDS BITS_TO_LONGS (MAX_PRIO)
+
+_Static_assert (MLQ_BITMAP_WORDS <= MLQ_BITS_PER_WORD,
+                "MAX_PRIO is too large for a one-word MLQ summary");
+
+/**
+ * @brief
+ *      A whole MLQ, owned by one CPU. Every CPU dispatches from its own MLQ
+ * under its own lock, so CPUs do not serialize on a single queue_lock.
+ *
+ *  bitmap    : bit `prio` is set iff ready[prio] is not empty.
+ *  exhausted : bit `prio` is set iff ready[prio] has used all of its
+ *              (MAX_PRIO - prio) slots in the current cycle.
+ *  summary   : bit `w` is set iff bitmap[w] is not zero.
+ *
+ *  Slot counters are reset lazily: a new cycle only bumps `cycle`, and the
+ *  `slots` of a queue is meaningful only if slots_cycle[prio] matches it.
+ *
+ *  clock     : number of dispatches from this MLQ, the time base of aging.
+ *
+ * @note
+ *      Everything but `nr_queued` is protected by `lock`. `nr_queued` is
+ * also read without the lock as a load hint by add_proc() and the stealer.
+ *
+ * @note
+ *      With MLQ_LOCKFREE, the processes of each priority live in the
+ * lock-free queue lf_ready[prio] instead, and `ready` only keeps the slot
+ * counters. put_mlq_proc() then never takes `lock`: it pushes to lf_ready,
+ * and updates lf_count, the bitmaps and nr_queued atomically. Dispatching
+ * still takes `lock` to keep the slot accounting consistent.
+ */
+struct mlq_rq_t
+{
+    pthread_mutex_t lock;
+    struct queue_t ready[MAX_PRIO];
+#ifdef MLQ_LOCKFREE
+    struct mpmc_queue_t lf_ready[MAX_PRIO];
+    int lf_count[MAX_PRIO];
 #endif
+    unsigned long bitmap[MLQ_BITMAP_WORDS];
+    unsigned long exhausted[MLQ_BITMAP_WORDS];
+    unsigned long summary;
+    unsigned long cycle;
+    unsigned long slots_cycle[MAX_PRIO];
+    uint64_t clock;
+    int current_prio;
+    int nr_queued;
+};
 
-#ifdef MLQ_SCHED
-void
-reset_slots (void)
+static struct mlq_rq_t *mlq_rq = NULL; // One MLQ per CPU
+static unsigned long mlq_nr_stolen = 0;
+static unsigned long mlq_nr_boosted = 0;
+#ifdef MLQ_LOCKFREE
+static int mlq_aging_rate = 0; // The lock-free levels can not be aged
+#else
+static int mlq_aging_rate = MLQ_AGING_RATE;
+#endif
+
+/*
+ * The occupancy bits are updated atomically, since lock-free producers set
+ * them without holding rq->lock. The bitmap word is always set before the
+ * summary bit, and a cleared summary bit is restored if a producer raced
+ * with us.
+ */
+static inline void
+mlq_mark_queued (struct mlq_rq_t *rq, unsigned long prio)
 {
-    unsigned long prio;
-    for (prio = 0; prio < MAX_PRIO; prio++)
-        mlq_ready_queue[prio].slots = 0; // Reset the round-robin counter
-                                         // for each every queue
-    current_prio = 0;
+    __atomic_fetch_or (&rq->bitmap[prio / MLQ_BITS_PER_WORD],
+                       1UL << (prio % MLQ_BITS_PER_WORD), __ATOMIC_SEQ_CST);
+    __atomic_fetch_or (&rq->summary, 1UL << (prio / MLQ_BITS_PER_WORD),
+                       __ATOMIC_SEQ_CST);
+}
+
+static inline void
+mlq_mark_empty (struct mlq_rq_t *rq, unsigned long prio)
+{
+    unsigned long w = prio / MLQ_BITS_PER_WORD;
+    if (__atomic_and_fetch (&rq->bitmap[w],
+                            ~(1UL << (prio % MLQ_BITS_PER_WORD)),
+                            __ATOMIC_SEQ_CST)
+        == 0)
+        {
+            __atomic_fetch_and (&rq->summary, ~(1UL << w), __ATOMIC_SEQ_CST);
+            if (__atomic_load_n (&rq->bitmap[w], __ATOMIC_SEQ_CST) != 0)
+                __atomic_fetch_or (&rq->summary, 1UL << w, __ATOMIC_SEQ_CST);
+        }
+}
+
+static inline void
+mlq_mark_exhausted (struct mlq_rq_t *rq, unsigned long prio)
+{
+    rq->exhausted[prio / MLQ_BITS_PER_WORD]
+        |= 1UL << (prio % MLQ_BITS_PER_WORD);
+}
+
+static inline int
+mlq_is_exhausted (struct mlq_rq_t *rq, unsigned long prio)
+{
+    return (rq->exhausted[prio / MLQ_BITS_PER_WORD]
+            >> (prio % MLQ_BITS_PER_WORD))
+           & 1;
+}
+
+/**
+ * @brief
+ *      Find the first non-empty queue whose priority is greater than or
+ *      equal to `start`. Exhausted queues are skipped if `skip_exhausted`.
+ *
+ * @return
+ *      The priority of that queue, -1 if there is none.
+ */
+static int
+mlq_find_next (struct mlq_rq_t *rq, unsigned long start, int skip_exhausted)
+{
+    unsigned long first = start / MLQ_BITS_PER_WORD;
+    unsigned long words = __atomic_load_n (&rq->summary, __ATOMIC_SEQ_CST)
+                          & (~0UL << first);
+
+    if (start >= MAX_PRIO)
+        return -1;
+    while (words)
+        {
+            unsigned long w = __builtin_ctzl (words);
+            unsigned long bits
+                = __atomic_load_n (&rq->bitmap[w], __ATOMIC_SEQ_CST);
+            if (skip_exhausted)
+                bits &= ~rq->exhausted[w];
+            if (w == first)
+                bits &= ~0UL << (start % MLQ_BITS_PER_WORD);
+            if (bits)
+                return w * MLQ_BITS_PER_WORD + __builtin_ctzl (bits);
+            words &= words - 1; // drop the lowest word, try the next one
+        }
+    return -1;
+}
+
+/**
+ * @brief
+ *      Charge one slot to queue `prio` of `rq`, and mark it exhausted if it
+ *      has used up its budget for this cycle.
+ */
+static void
+mlq_charge_slot (struct mlq_rq_t *rq, int prio)
+{
+    struct queue_t *priority_queue = &rq->ready[prio];
+    if (rq->slots_cycle[prio] != rq->cycle)
+        {
+            priority_queue->slots = 0; // first visit in this cycle
+            rq->slots_cycle[prio] = rq->cycle;
+        }
+    // because a process will exec in 1 time slice,
+    // increment "slots" counter by 1
+    priority_queue->slots++;
+    if (priority_queue->slots >= MAX_PRIO - prio)
+        mlq_mark_exhausted (rq, prio); // next queue please
+}
+
+static void
+mlq_account (struct mlq_rq_t *rq, int delta)
+{
+    __atomic_add_fetch (&rq->nr_queued, delta, __ATOMIC_RELAXED);
+    sched_account (delta);
+}
+
+/**
+ * @brief
+ *      Push `proc` to the queue of priority `prio` and mark it as queued.
+ *
+ * @return 0 on success, -1 if the queue is full and can not grow.
+ */
+static int
+mlq_level_push (struct mlq_rq_t *rq, int prio, struct pcb_t *proc)
+{
+#ifdef MLQ_LOCKFREE
+    if (mpmc_enqueue (&rq->lf_ready[prio], proc) != 0)
+        return -1;
+    __atomic_add_fetch (&rq->lf_count[prio], 1, __ATOMIC_SEQ_CST);
+#else
+    if (enqueue (&rq->ready[prio], proc) != 0)
+        return -1;
+#endif
+    mlq_mark_queued (rq, prio);
+    mlq_account (rq, 1);
+    return 0;
 }
+
+/**
+ * @brief
+ *      Pop a process from the queue of priority `prio`, from the front or
+ *      from the tail. The queue is marked empty when it is drained.
+ *
+ *      From the front, a process which last ran on the CPU owning `rq` is
+ * preferred among the first SCHED_AFFINITY_LOOKAHEAD ones, so that it finds
+ * its cache warm.
+ *
+ * @note The lock-free queues can only be popped from the front, in FIFO
+ * order. They may
+ * also return NULL although their bit is set, if a producer has claimed a
+ * cell but not published it yet.
+ */
+static struct pcb_t *
+mlq_level_pop (struct mlq_rq_t *rq, int prio,
+               int from_tail __attribute__ ((unused)))
+{
+    struct pcb_t *proc;
+#ifdef MLQ_LOCKFREE
+    int left;
+
+    proc = mpmc_dequeue (&rq->lf_ready[prio]);
+    if (proc != NULL)
+        left = __atomic_sub_fetch (&rq->lf_count[prio], 1, __ATOMIC_SEQ_CST);
+    else
+        left = __atomic_load_n (&rq->lf_count[prio], __ATOMIC_SEQ_CST);
+    if (left == 0)
+        {
+            mlq_mark_empty (rq, prio);
+            /* A producer may have pushed in between, keep its bit */
+            if (__atomic_load_n (&rq->lf_count[prio], __ATOMIC_SEQ_CST) != 0)
+                mlq_mark_queued (rq, prio);
+        }
+#else
+    struct queue_t *q = &rq->ready[prio];
+
+    proc = from_tail ? dequeue_tail (q)
+                     : dequeue_affine (q, rq - mlq_rq, SCHED_AFFINITY_LOOKAHEAD);
+    if (empty (q))
+        mlq_mark_empty (rq, prio);
 #endif
+    if (proc != NULL)
+        mlq_account (rq, -1);
+    return proc;
+}
 
-int
-queue_empty (void)
+/* `rq` must be zero-initialized, which makes all its queues empty */
+static void
+mlq_init_rq (struct mlq_rq_t *rq)
 {
-#ifdef MLQ_SCHED
-    /**
-     * Check if all queues in MLQ are empty
-     * */
-    unsigned long prio;
+    pthread_mutex_init (&rq->lock, NULL);
+#ifdef MLQ_LOCKFREE
+    int prio;
     for (prio = 0; prio < MAX_PRIO; prio++)
-        if (!empty (&mlq_ready_queue[prio]))
-            return -1;
-    return 1;
-#endif // MLQ_SCHED
-    // return (empty (&ready_queue) && empty (&run_queue));
-    // DEPRECATED
+        if (mpmc_init (&rq->lf_ready[prio], MLQ_LOCKFREE_CAP) != 0)
+            {
+                printf ("Error: in sched.c / mlq_init_rq() :\n");
+                printf ("Can not allocate the lock-free queues.\n");
+                exit (1);
+            }
+#endif
 }
 
-void
-init_scheduler (void)
+static void
+reset_slots (struct mlq_rq_t *rq)
+{
+    unsigned long w;
+    rq->cycle++; // Reset the round-robin counter for each every queue
+    for (w = 0; w < MLQ_BITMAP_WORDS; w++)
+        rq->exhausted[w] = 0;
+    rq->current_prio = 0;
+}
+
+static int
+mlq_nr_queued (int cpu)
+{
+    return __atomic_load_n (&mlq_rq[cpu].nr_queued, __ATOMIC_RELAXED);
+}
+
+static void
+mlq_init (int num_cpus)
 {
-#ifdef MLQ_SCHED
     int i;
 
-    for (i = 0; i < MAX_PRIO; i++)
+    mlq_rq = calloc (num_cpus, sizeof (struct mlq_rq_t));
+    for (i = 0; i < num_cpus; i++)
+        mlq_init_rq (&mlq_rq[i]);
+    mlq_nr_stolen = 0;
+    mlq_nr_boosted = 0;
+}
+
+static void
+mlq_finish (void)
+{
+    int i;
+
+    for (i = 0; i < sched_nr_cpus; i++)
         {
-            mlq_ready_queue[i].size = 0;
-            mlq_ready_queue[i].slots = 0;
-        }
+            int prio;
+            for (prio = 0; prio < MAX_PRIO; prio++)
+                {
+                    release_queue (&mlq_rq[i].ready[prio]);
+#ifdef MLQ_LOCKFREE
+                    mpmc_destroy (&mlq_rq[i].lf_ready[prio]);
 #endif
-    // DEPRECATED
-    // ready_queue.size = 0;
-    // DEPRECATED
-    // run_queue.size = 0;
-    pthread_mutex_init (&queue_lock, NULL);
+                }
+            pthread_mutex_destroy (&mlq_rq[i].lock);
+        }
+    free (mlq_rq);
+    mlq_rq = NULL;
 }
 
-void
-finish_scheduler (void)
+/**
+ * @brief
+ *      Age the processes waiting in `rq`, whose lock must be held. The front
+ * (oldest) process of each level is raised one level every `mlq_aging_rate`
+ * dispatches it has waited, so a low priority process can not starve behind
+ * a stream of higher priority ones. Its `prio` is untouched: the boost only
+ * lasts until it is dispatched, then it is put back to its own level.
+ *
+ *      A process is never raised above `current_prio`: the levels before it
+ * have had their turn in this cycle, so it would wait for the next one.
+ *
+ *      The walk looks at every non-empty level, so it is only done once
+ * every `mlq_aging_rate` dispatches, which keeps the cost of a dispatch
+ * flat. A process may then be raised up to `mlq_aging_rate` - 1 dispatches
+ * late.
+ *
+ * @note
+ *      The lock-free levels can not be looked into, they are not aged, and
+ * sched_set_aging() refuses a nonzero rate.
+ */
+static void
+mlq_age (struct mlq_rq_t *rq __attribute__ ((unused)))
 {
-    pthread_mutex_destroy (&queue_lock);
+#ifndef MLQ_LOCKFREE
+    int prio;
+
+    if (mlq_aging_rate <= 0 || rq->clock % mlq_aging_rate != 0)
+        return;
+    for (prio = mlq_find_next (rq, rq->current_prio + 1, 0); prio > 0;
+         prio = mlq_find_next (rq, prio + 1, 0))
+        {
+            struct queue_t *q = &rq->ready[prio];
+            struct pcb_t *proc = q->proc[0];
+            if (rq->clock - proc->queued_at
+                < (uint64_t)mlq_aging_rate * (proc->boost + 1))
+                continue;
+
+            dequeue (q);
+            if (empty (q))
+                mlq_mark_empty (rq, prio);
+            if (enqueue (&rq->ready[prio - 1], proc) != 0)
+                {
+                    printf ("Error: in sched.c / mlq_age() :\n");
+                    printf ("Can not grow the queue of prio %d.\n", prio - 1);
+                    exit (1);
+                }
+            mlq_mark_queued (rq, prio - 1);
+            proc->boost++;
+            __atomic_add_fetch (&mlq_nr_boosted, 1, __ATOMIC_RELAXED);
+        }
+#endif
 }
 
-#ifdef MLQ_SCHED
 /*
  *  Stateful design for routine calling
  *  based on the priority and our MLQ policy
  *  We implement stateful here using transition technique
  *  State representation   prio = 0 .. MAX_PRIO, curr_slot = 0..(MAX_PRIO -
  *  prio)
+ *
+ *  Walking the queues from `current_prio` and skipping the empty or
+ *  exhausted ones is a find-first-set on the bitmaps. When no queue is left
+ *  until the end of the MLQ, a new cycle begins: all slots are reset and we
+ *  are back to the highest priority queue.
  */
-struct pcb_t *
-get_mlq_proc (void)
+static struct pcb_t *
+get_mlq_proc (struct mlq_rq_t *rq)
 {
-    /**TODO:
-     Get a process from PRIORITY [ready_queue].
-     Use lock to protect the queue.
-     @return the process from ready_queue
-     */
     struct pcb_t *proc = NULL;
+    int prio;
 
+    pthread_mutex_lock (&rq->lock);
     /* If all queues are empty, return NULL */
-    if (queue_empty () == 1)
-        return proc;
+    if (__atomic_load_n (&rq->summary, __ATOMIC_SEQ_CST) == 0)
+        {
+            pthread_mutex_unlock (&rq->lock);
+            return proc;
+        }
 
-    int designated_slots;
-    int num_queues_out_slots = 0;
-    while (1)
+    mlq_age (rq);
+    int new_cycle = 0;
+    prio = mlq_find_next (rq, rq->current_prio, 1);
+    while (proc == NULL)
         {
-            /** LOOP THROUGH MLQ
-             * @if a queue is empty
-             * continue to next queue
-             * @else
-             *  @if ran out of designated slots (time slices)?
-             *  continue to next queue
-             *  @else
-             *  get the first process
-             */
-            // If all queues have run out of slots,
-            // we reset their slots and are back
-            // to the highest priority queue.
-
-            // @note NK : DERPRECATE THIS
-            // if (num_queues_out_slots == MAX_PRIO)
-            //     reset_slots ();
-
-            // Otherwise, compute the number of slots a queue gets
-            designated_slots = MAX_PRIO - current_prio;
-            // access the corresponding prio queue in the MLQ
-            struct queue_t *priority_queue = &mlq_ready_queue[current_prio];
-            // check emptiness
-            if (priority_queue->size != 0)
-                {
-                    // out of slots?
-                    if (priority_queue->slots == designated_slots)
-                        {
-                            // increase the out-of-slots counter
-                            // num_queues_out_slots++;
-                            // increase the prio counter
-                            current_prio = (current_prio + 1)
-                                           % MAX_PRIO; // next queue please
-                        }
-                    else // just get the first process from the queue
-                        {
-                            pthread_mutex_lock (&queue_lock);
-                            proc = dequeue (priority_queue);
-                            // because a process will exec in 1 time slice,
-                            // increment "slots" counter by 1
-                            priority_queue->slots++;
-                            pthread_mutex_unlock (&queue_lock);
-                            return proc;
-                        }
-                }
-            else
+            if (prio < 0 && new_cycle) // only lock-free pushes in flight
+                break;
+            if (prio < 0) // A new cycle has began, reset all queues
                 {
-                    current_prio
-                        = (current_prio + 1) % MAX_PRIO; // next queue please
+                    reset_slots (rq);
+                    new_cycle = 1;
+                    prio = mlq_find_next (rq, 0, 1);
+                    continue;
                 }
+            proc = mlq_level_pop (rq, prio, 0);
+            if (proc == NULL) // not published yet, next queue please
+                prio = mlq_find_next (rq, prio + 1, 1);
+        }
+    if (proc != NULL)
+        {
+            rq->current_prio = prio;
+            mlq_charge_slot (rq, prio);
+            rq->clock++;
+            proc->boost = 0;
+        }
+    pthread_mutex_unlock (&rq->lock);
+    return proc;
+}
 
-            if (current_prio == 0) // A new cycle has began, reset all queues
+/**
+ * @brief
+ *      Steal a process for the idle CPU `thief`. The victim is the CPU with
+ * the most queued processes, and we take the process at the tail of its
+ * highest priority queue, i.e. the one that would wait the longest there.
+ *
+ * @return A ptr to the stolen `pcb_t`, NULL if no CPU has work to spare.
+ */
+static struct pcb_t *
+steal_mlq_proc (struct mlq_rq_t *thief)
+{
+    struct mlq_rq_t *victim = NULL;
+    struct pcb_t *proc = NULL;
+    int max_queued = 0;
+    int i, prio;
+
+    for (i = 0; i < sched_nr_cpus; i++)
+        {
+            int queued = __atomic_load_n (&mlq_rq[i].nr_queued,
+                                          __ATOMIC_RELAXED);
+            if (&mlq_rq[i] != thief && queued > max_queued)
                 {
-                    reset_slots ();
+                    max_queued = queued;
+                    victim = &mlq_rq[i];
                 }
         }
+    if (victim == NULL)
+        return NULL;
+
+    pthread_mutex_lock (&victim->lock);
+    prio = mlq_find_next (victim, 0, 0);
+    if (prio >= 0)
+        proc = mlq_level_pop (victim, prio, 1);
+    pthread_mutex_unlock (&victim->lock);
+
+    if (proc != NULL)
+        {
+            /* The thief pays the slot, as if it dispatched from its own
+             * queue of the same priority */
+            pthread_mutex_lock (&thief->lock);
+            mlq_charge_slot (thief, prio);
+            thief->clock++;
+            pthread_mutex_unlock (&thief->lock);
+            proc->boost = 0;
+            __atomic_add_fetch (&mlq_nr_stolen, 1, __ATOMIC_RELAXED);
+        }
+    return proc;
 }
 
-void
-put_mlq_proc (struct pcb_t *proc)
+/**
+ * @brief
+ *      Serve a new process of priority `prio` in this cycle if its level
+ * still has slots, e.g. one sent to `rq` to preempt a less urgent one. The
+ * lock of `rq` must be held. A process put back does not rewind the cycle,
+ * it waits for the next one.
+ */
+static void
+mlq_rewind (struct mlq_rq_t *rq, int prio)
+{
+    if (prio < rq->current_prio && !mlq_is_exhausted (rq, prio))
+        rq->current_prio = prio;
+}
+
+static void
+put_mlq_proc (struct mlq_rq_t *rq, struct pcb_t *proc, int arrival)
 {
     /** TODO
      * adds a process to the MLQ policy according to its priority
@@ -191,19 +566,48 @@ put_mlq_proc (struct pcb_t *proc)
      * @remark NK agreed with your idea
      *
      */
-    pthread_mutex_lock (&queue_lock);
-    //    printf ("\nlook at its prio: %d\n", proc->prio);
-    if (proc->prio < 0 || proc->prio >= MAX_PRIO)
+    if (proc->prio >= MAX_PRIO)
+        return;
+
+#ifdef MLQ_LOCKFREE
+    /* A full lock-free queue overflows to the same queue of the next CPUs.
+     * Only an arrival takes the lock, to rewind the cycle. */
+    int i, cpu = rq - mlq_rq;
+    for (i = 0; i < sched_nr_cpus; i++)
         {
-            pthread_mutex_unlock (&queue_lock);
+            rq = &mlq_rq[(cpu + i) % sched_nr_cpus];
+            if (mlq_level_push (rq, proc->prio, proc) != 0)
+                continue;
+            if (arrival)
+                {
+                    pthread_mutex_lock (&rq->lock);
+                    mlq_rewind (rq, proc->prio);
+                    pthread_mutex_unlock (&rq->lock);
+                }
             return;
         }
-    enqueue (&mlq_ready_queue[proc->prio], proc);
-    pthread_mutex_unlock (&queue_lock);
+    printf ("Error: in sched.c / put_mlq_proc() :\n");
+    printf ("Lock-free queues of prio %d are full, raise MLQ_LOCKFREE_CAP.\n",
+            proc->prio);
+    exit (1);
+#else
+    pthread_mutex_lock (&rq->lock);
+    proc->queued_at = rq->clock;
+    proc->boost = 0;
+    if (arrival)
+        mlq_rewind (rq, proc->prio);
+    if (mlq_level_push (rq, proc->prio, proc) != 0)
+        {
+            printf ("Error: in sched.c / put_mlq_proc() :\n");
+            printf ("Can not grow the queue of prio %d.\n", proc->prio);
+            exit (1);
+        }
+    pthread_mutex_unlock (&rq->lock);
+#endif
 }
 
-void
-add_mlq_proc (struct pcb_t *proc)
+static void
+mlq_enqueue (int cpu, struct pcb_t *proc)
 {
     /** TODO
      * @attention What is the difference between this and put_mlq_proc?
@@ -211,28 +615,504 @@ add_mlq_proc (struct pcb_t *proc)
      *
      * @remark NK agreed with your idea
      */
-    pthread_mutex_lock (&queue_lock);
-    if (proc->prio < 0 || proc->prio >= MAX_PRIO)
+    /* Not dispatched yet, it is an arrival, maybe sent to `cpu` to preempt */
+    int arrival = proc->last_cpu < 0;
+    if (cpu == SCHED_NEW_PROC)
+        cpu = sched_pick_cpu (mlq_nr_queued);
+    put_mlq_proc (&mlq_rq[cpu], proc, arrival);
+}
+
+static struct pcb_t *
+mlq_pick_next (int cpu)
+{
+    struct pcb_t *proc = get_mlq_proc (&mlq_rq[cpu]);
+    if (proc == NULL)
+        proc = steal_mlq_proc (&mlq_rq[cpu]);
+    return proc;
+}
+
+static int
+mlq_rank (struct pcb_t *proc)
+{
+    return proc->prio;
+}
+
+/* Empty the MLQ of the offline `cpu` into the MLQs of the online ones */
+static int
+mlq_migrate (int cpu)
+{
+    struct mlq_rq_t *rq = &mlq_rq[cpu];
+    struct pcb_t *proc;
+    int moved = 0, prio;
+
+    while (1)
         {
-            pthread_mutex_unlock (&queue_lock);
-            return;
+            proc = NULL;
+            pthread_mutex_lock (&rq->lock);
+            prio = mlq_find_next (rq, 0, 0);
+            if (prio >= 0)
+                proc = mlq_level_pop (rq, prio, 0);
+            pthread_mutex_unlock (&rq->lock);
+            if (proc == NULL)
+                return moved;
+            put_mlq_proc (&mlq_rq[sched_pick_cpu (mlq_nr_queued)], proc, 0);
+            moved++;
         }
-    enqueue (&mlq_ready_queue[proc->prio], proc);
-    pthread_mutex_unlock (&queue_lock);
+}
+
+static void
+mlq_stats (void)
+{
+    printf ("MLQ: %lu processes stolen, %lu aging boosts\n", mlq_nr_stolen,
+            mlq_nr_boosted);
+}
+
+const struct sched_class_t mlq_sched_class = {
+    .name = "mlq",
+    .init = mlq_init,
+    .finish = mlq_finish,
+    .enqueue = mlq_enqueue,
+    .pick_next = mlq_pick_next,
+    .stats = mlq_stats,
+    .rank = mlq_rank,
+    .migrate = mlq_migrate,
+};
+
+/*
+ * Earliest deadline first (EDF) class. The admitted processes are kept in
+ * one heap shared by all CPUs, keyed on their absolute deadline, so that
+ * every CPU runs the most urgent of them (global EDF). `edf_nr_queued` is
+ * read without the lock, to skip the class when it is empty.
+ */
+static struct queue_t edf_ready;
+static pthread_mutex_t edf_lock = PTHREAD_MUTEX_INITIALIZER;
+static int edf_nr_queued = 0;
+static unsigned long edf_util = 0; // Admitted shares, in 1/EDF_UTIL_UNIT
+static unsigned long edf_nr_admitted = 0;
+static unsigned long edf_nr_rejected = 0;
+static int edf_clock_rate = 1; // Instructions a CPU runs in a slot
+
+/**
+ * @brief
+ *      Slots `proc` runs at most, a clock of instructions in each. Fused
+ * runs and forward jumps only make it shorter.
+ *
+ * @return The slots, 0 if its code jumps backward: a loop runs as many
+ * times as its counter says, which is only known when it runs.
+ */
+static unsigned long
+edf_cost (struct pcb_t *proc)
+{
+    struct code_seg_t *code = proc->code;
+    uint32_t i;
+
+    if (code == NULL || code->size == 0)
+        return 1;
+    for (i = 0; code->text != NULL && i < code->size; i++)
+        if ((code->text[i].opcode == JMP || code->text[i].opcode == JNZ)
+            && code->text[i].arg_0 <= i)
+            return 0;
+    return (code->size + edf_clock_rate - 1) / edf_clock_rate;
+}
+
+int
+sched_admit_deadline (struct pcb_t *proc, uint64_t now, uint64_t relative)
+{
+    unsigned long cost = edf_cost (proc);
+    unsigned long limit
+        = (unsigned long)__atomic_load_n (&sched_nr_online, __ATOMIC_RELAXED)
+          * EDF_UTIL_UNIT * EDF_MAX_UTIL / 100;
+    unsigned long util;
+
+    if (relative == 0)
+        return -1;
+    util = (cost * EDF_UTIL_UNIT + relative - 1) / relative;
+
+    pthread_mutex_lock (&edf_lock);
+    if (cost == 0 || edf_util + util > limit)
+        {
+            edf_nr_rejected++;
+            pthread_mutex_unlock (&edf_lock);
+            return -1;
+        }
+    edf_util += util;
+    edf_nr_admitted++;
+    pthread_mutex_unlock (&edf_lock);
+
+    proc->deadline = now + relative;
+    proc->edf_util = util;
+    return 0;
+}
+
+static void
+edf_enqueue (struct pcb_t *proc)
+{
+    uint32_t key = proc->deadline > UINT32_MAX ? UINT32_MAX : proc->deadline;
+
+    pthread_mutex_lock (&edf_lock);
+    if (enqueue_prio (&edf_ready, proc, key) != 0)
+        {
+            printf ("Error: in sched.c / edf_enqueue() :\n");
+            printf ("Can not grow the EDF queue.\n");
+            exit (1);
+        }
+    __atomic_add_fetch (&edf_nr_queued, 1, __ATOMIC_RELAXED);
+    sched_account (1);
+    pthread_mutex_unlock (&edf_lock);
+}
+
+static struct pcb_t *
+edf_pick_next (void)
+{
+    struct pcb_t *proc;
+
+    if (__atomic_load_n (&edf_nr_queued, __ATOMIC_RELAXED) == 0)
+        return NULL;
+    pthread_mutex_lock (&edf_lock);
+    proc = dequeue_prio (&edf_ready);
+    if (proc != NULL)
+        {
+            __atomic_sub_fetch (&edf_nr_queued, 1, __ATOMIC_RELAXED);
+            sched_account (-1);
+        }
+    pthread_mutex_unlock (&edf_lock);
+    return proc;
+}
+
+static void
+edf_exit (struct pcb_t *proc)
+{
+    pthread_mutex_lock (&edf_lock);
+    edf_util -= proc->edf_util;
+    pthread_mutex_unlock (&edf_lock);
+    proc->edf_util = 0;
+}
+
+int
+sched_set_aging (int rate)
+{
+#ifdef MLQ_LOCKFREE
+    if (rate != 0)
+        return -1;
+#endif
+    mlq_aging_rate = rate;
+    return 0;
+}
+
+void
+sched_set_clock (int rate)
+{
+    edf_clock_rate = rate;
+}
+
+void
+sched_account (int delta)
+{
+    __atomic_add_fetch (&sched_nr_queued, delta, __ATOMIC_RELAXED);
+}
+
+int
+sched_pick_cpu (int (*nr_queued) (int cpu))
+{
+    int start = __atomic_fetch_add (&sched_next_cpu, 1, __ATOMIC_RELAXED);
+    int best = -1;
+    int i;
+
+    for (i = 0; i < sched_nr_cpus; i++)
+        {
+            int cpu = (start + i) % sched_nr_cpus;
+            if (sched_online (cpu)
+                && (best < 0 || nr_queued (cpu) < nr_queued (best)))
+                best = cpu;
+        }
+    return best >= 0 ? best : start % sched_nr_cpus;
+}
+
+int
+queue_empty (void)
+{
+    /**
+     * Check if all queues of the policy are empty
+     * */
+    return __atomic_load_n (&sched_nr_queued, __ATOMIC_RELAXED) ? -1 : 1;
+}
+
+int
+init_scheduler_policy (const char *name, int num_cpus)
+{
+    int i;
+
+    for (i = 0; sched_classes[i] != NULL; i++)
+        if (!strcmp (sched_classes[i]->name, name))
+            break;
+    if (sched_classes[i] == NULL)
+        return -1;
+
+    sched_class = sched_classes[i];
+    sched_nr_cpus = num_cpus;
+    sched_nr_queued = 0;
+    sched_next_cpu = 0;
+    sched_nr_affine = 0;
+    sched_nr_migrated = 0;
+    edf_nr_queued = 0;
+    edf_util = 0;
+    edf_nr_admitted = edf_nr_rejected = 0;
+    sched_cpu_rank = malloc (sizeof (int) * num_cpus);
+    sched_resched = calloc (num_cpus, sizeof (int));
+    for (i = 0; i < num_cpus; i++)
+        sched_cpu_rank[i] = SCHED_RANK_IDLE;
+    sched_nr_preempted = 0;
+    sched_idle_mask = calloc (BITS_TO_LONGS (num_cpus), sizeof (long));
+    sched_nr_parked = sched_nr_woken = 0;
+    sched_cpu_online = malloc (sizeof (int) * num_cpus);
+    for (i = 0; i < num_cpus; i++)
+        sched_cpu_online[i] = 1;
+    sched_nr_online = num_cpus;
+    sched_nr_onlined = sched_nr_offlined = sched_nr_moved = 0;
+    sched_class->init (num_cpus);
+    return 0;
+}
+
+void
+init_scheduler (void)
+{
+    init_scheduler_smp (1);
+}
+
+void
+init_scheduler_smp (int num_cpus)
+{
+    init_scheduler_policy (mlq_sched_class.name, num_cpus);
+}
+
+void
+init_scheduler_cfs (int num_cpus)
+{
+    init_scheduler_policy (cfs_sched_class.name, num_cpus);
+}
+
+void
+finish_scheduler (void)
+{
+    sched_class->finish ();
+    release_queue (&edf_ready);
+    free (sched_cpu_rank);
+    free (sched_resched);
+    free (sched_idle_mask);
+    free (sched_cpu_online);
+    sched_cpu_rank = sched_resched = sched_cpu_online = NULL;
+    sched_idle_mask = NULL;
+    sched_nr_cpus = 0;
+    sched_nr_queued = 0;
+}
+
+int
+sched_park (int cpu)
+{
+    unsigned long *word = &sched_idle_mask[cpu / MLQ_BITS_PER_WORD];
+    unsigned long bit = 1UL << (cpu % MLQ_BITS_PER_WORD);
+
+    __atomic_fetch_or (word, bit, __ATOMIC_SEQ_CST);
+    /* Pairs with sched_wake_idle(): either it sees our bit, or we see the
+     * process it has queued */
+    if (__atomic_load_n (&sched_nr_queued, __ATOMIC_SEQ_CST) != 0)
+        {
+            __atomic_fetch_and (word, ~bit, __ATOMIC_SEQ_CST);
+            return -1;
+        }
+    __atomic_add_fetch (&sched_nr_parked, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+int
+sched_parked (int cpu)
+{
+    return (__atomic_load_n (&sched_idle_mask[cpu / MLQ_BITS_PER_WORD],
+                             __ATOMIC_ACQUIRE)
+            >> (cpu % MLQ_BITS_PER_WORD))
+           & 1;
+}
+
+/**
+ * @brief
+ *      A process has just been queued: wake up one parked CPU, `cpu` (the
+ * last CPU of the process) if it is parked, else the first one. It takes
+ * the process from its own queue, or steals it.
+ */
+static void
+sched_wake_idle (int cpu)
+{
+    int w;
+
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+    if (cpu >= 0 && sched_parked (cpu))
+        {
+            unsigned long bit = 1UL << (cpu % MLQ_BITS_PER_WORD);
+            if (__atomic_fetch_and (&sched_idle_mask[cpu / MLQ_BITS_PER_WORD],
+                                    ~bit, __ATOMIC_SEQ_CST)
+                & bit)
+                {
+                    __atomic_add_fetch (&sched_nr_woken, 1, __ATOMIC_RELAXED);
+                    return;
+                }
+        }
+    for (w = 0; w < (int)BITS_TO_LONGS (sched_nr_cpus); w++)
+        {
+            unsigned long mask
+                = __atomic_load_n (&sched_idle_mask[w], __ATOMIC_SEQ_CST);
+            while (mask)
+                {
+                    unsigned long bit = mask & -mask;
+                    if (__atomic_fetch_and (&sched_idle_mask[w], ~bit,
+                                            __ATOMIC_SEQ_CST)
+                        & bit)
+                        {
+                            __atomic_add_fetch (&sched_nr_woken, 1,
+                                                __ATOMIC_RELAXED);
+                            return;
+                        }
+                    mask &= ~bit; // another waker took it
+                }
+        }
+}
+
+int
+sched_set_online (int cpu, int online)
+{
+    if (cpu < 0 || cpu >= sched_nr_cpus)
+        return -1;
+    online = online != 0;
+    if (sched_cpu_online[cpu] == online)
+        return 0;
+    __atomic_store_n (&sched_cpu_online[cpu], online, __ATOMIC_RELEASE);
+    __atomic_add_fetch (&sched_nr_online, online ? 1 : -1, __ATOMIC_RELAXED);
+    __atomic_store_n (&sched_cpu_rank[cpu], SCHED_RANK_IDLE,
+                      __ATOMIC_RELAXED);
+    __atomic_store_n (&sched_resched[cpu], 0, __ATOMIC_RELAXED);
+    if (online)
+        __atomic_add_fetch (&sched_nr_onlined, 1, __ATOMIC_RELAXED);
+    else
+        {
+            /* Nobody should wake it up for new work any more */
+            __atomic_fetch_and (&sched_idle_mask[cpu / MLQ_BITS_PER_WORD],
+                                ~(1UL << (cpu % MLQ_BITS_PER_WORD)),
+                                __ATOMIC_SEQ_CST);
+        }
+    return 0;
+}
+
+int
+sched_online (int cpu)
+{
+    return __atomic_load_n (&sched_cpu_online[cpu], __ATOMIC_ACQUIRE);
+}
+
+void
+sched_migrate (int cpu)
+{
+    int moved = 0;
+
+    if (sched_class->migrate != NULL)
+        moved = sched_class->migrate (cpu);
+    __atomic_add_fetch (&sched_nr_moved, moved, __ATOMIC_RELAXED);
+    __atomic_add_fetch (&sched_nr_offlined, 1, __ATOMIC_RELAXED);
+    while (moved-- > 0)
+        sched_wake_idle (-1);
+}
+
+/* Rank of `proc` running on a CPU, see sched_cpu_rank */
+static int
+sched_rank (struct pcb_t *proc)
+{
+    if (proc == NULL)
+        return SCHED_RANK_IDLE;
+    if (proc->deadline != 0 || sched_class->rank == NULL)
+        return SCHED_RANK_NONE;
+    return sched_class->rank (proc);
+}
+
+/**
+ * @brief
+ *      Find the CPU a new `proc` should preempt: the one running the
+ * process of the highest rank, if it is above the rank of `proc`. A process
+ * with a deadline is more urgent than any ranked one.
+ *
+ * @return That CPU, -1 if `proc` preempts nothing, e.g. a CPU is idle.
+ */
+static int
+sched_find_victim (struct pcb_t *proc)
+{
+    int victim = -1, worst, cpu;
+
+    if (proc->deadline != 0)
+        worst = SCHED_RANK_NONE;
+    else if (sched_class->rank != NULL)
+        worst = sched_class->rank (proc);
+    else
+        return -1;
+
+    for (cpu = 0; cpu < sched_nr_cpus; cpu++)
+        {
+            int rank = __atomic_load_n (&sched_cpu_rank[cpu], __ATOMIC_RELAXED);
+            if (!sched_online (cpu))
+                continue;
+            if (rank == SCHED_RANK_IDLE) // it will pick `proc` up
+                return -1;
+            if (rank > worst)
+                {
+                    worst = rank;
+                    victim = cpu;
+                }
+        }
+    return victim;
+}
+
+struct pcb_t *
+get_cpu_proc (int cpu)
+{
+    struct pcb_t *proc = edf_pick_next ();
+
+    if (proc == NULL)
+        proc = sched_class->pick_next (cpu);
+    __atomic_store_n (&sched_resched[cpu], 0, __ATOMIC_RELAXED);
+    __atomic_store_n (&sched_cpu_rank[cpu], sched_rank (proc),
+                      __ATOMIC_RELAXED);
+    if (proc == NULL)
+        return NULL;
+    if (proc->last_cpu == cpu)
+        __atomic_add_fetch (&sched_nr_affine, 1, __ATOMIC_RELAXED);
+    else if (proc->last_cpu >= 0) // the first dispatch is not a migration
+        __atomic_add_fetch (&sched_nr_migrated, 1, __ATOMIC_RELAXED);
+    proc->last_cpu = cpu;
+    return proc;
+}
+
+void
+put_cpu_proc (int cpu, struct pcb_t *proc)
+{
+    __atomic_store_n (&sched_cpu_rank[cpu], SCHED_RANK_IDLE, __ATOMIC_RELAXED);
+    if (proc->deadline != 0)
+        edf_enqueue (proc);
+    else
+        sched_class->enqueue (cpu, proc);
+    /* `cpu` dispatches right away, wake up another one only if there is
+     * more than one process for it */
+    if (__atomic_load_n (&sched_nr_queued, __ATOMIC_SEQ_CST) > 1)
+        sched_wake_idle (-1);
 }
 
 /* Get a proc from queue */
 struct pcb_t *
 get_proc (void)
 {
-    return get_mlq_proc ();
+    return get_cpu_proc (0);
 }
 
 /* Put an unfinised proc back to queue */
 void
 put_proc (struct pcb_t *proc)
 {
-    return put_mlq_proc (proc);
+    return put_cpu_proc (0, proc);
 }
 
 /**
@@ -244,32 +1124,68 @@ put_proc (struct pcb_t *proc)
 void
 add_proc (struct pcb_t *proc)
 {
-    return add_mlq_proc (proc);
+    int victim = sched_find_victim (proc);
+    int last_cpu = proc->last_cpu;
+
+    if (proc->deadline != 0)
+        edf_enqueue (proc);
+    else
+        sched_class->enqueue (victim >= 0 ? victim : SCHED_NEW_PROC, proc);
+    if (victim >= 0)
+        __atomic_store_n (&sched_resched[victim], 1, __ATOMIC_RELEASE);
+    else
+        sched_wake_idle (last_cpu);
 }
-#else  // if not MLQ_SCHED (DEPRECATED)
-struct pcb_t *
-get_proc (void)
+
+int
+sched_need_resched (int cpu)
 {
-    struct pcb_t *proc = NULL;
-    /*TODO: get a process from [ready_queue].
-     * Remember to use lock to protect the queue.
-     * */
-    return proc;
+    if (!__atomic_exchange_n (&sched_resched[cpu], 0, __ATOMIC_ACQUIRE))
+        return 0;
+    __atomic_add_fetch (&sched_nr_preempted, 1, __ATOMIC_RELAXED);
+    return 1;
+}
+
+int
+get_time_slice (int cpu, struct pcb_t *proc, int time_slot)
+{
+    if (sched_class->time_slice == NULL || proc->deadline != 0)
+        return time_slot;
+    return sched_class->time_slice (cpu, proc, time_slot);
 }
 
 void
-put_proc (struct pcb_t *proc)
+sched_tick (int cpu, struct pcb_t *proc, uint64_t now)
 {
-    pthread_mutex_lock (&queue_lock);
-    enqueue (&run_queue, proc);
-    pthread_mutex_unlock (&queue_lock);
+    if (sched_class->on_tick != NULL && proc->deadline == 0)
+        sched_class->on_tick (cpu, proc, now);
 }
 
 void
-add_proc (struct pcb_t *proc)
+sched_exit (int cpu, struct pcb_t *proc)
+{
+    __atomic_store_n (&sched_cpu_rank[cpu], SCHED_RANK_IDLE, __ATOMIC_RELAXED);
+    if (proc->deadline != 0)
+        edf_exit (proc);
+    else if (sched_class->on_exit != NULL)
+        sched_class->on_exit (cpu, proc);
+}
+
+void
+sched_stats (void)
 {
-    pthread_mutex_lock (&queue_lock);
-    enqueue (&ready_queue, proc);
-    pthread_mutex_unlock (&queue_lock);
+    printf ("Dispatches: %lu on the last CPU, %lu migrated, %lu "
+            "preempted by an arrival\n",
+            sched_nr_affine, sched_nr_migrated, sched_nr_preempted);
+    printf ("Idle CPUs: %lu parked, %lu woken up\n", sched_nr_parked,
+            sched_nr_woken);
+    if (sched_nr_onlined + sched_nr_offlined != 0)
+        printf ("Hot-plug: %lu CPUs brought online, %lu offline, %lu "
+                "processes moved off\n",
+                sched_nr_onlined, sched_nr_offlined, sched_nr_moved);
+    if (edf_nr_admitted + edf_nr_rejected != 0)
+        printf ("EDF: %lu processes admitted, %lu rejected\n",
+                edf_nr_admitted, edf_nr_rejected);
+    if (sched_class->stats != NULL)
+        sched_class->stats ();
 }
-#endif // MLQ_SCHED
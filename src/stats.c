@@ -0,0 +1,232 @@
+/**
+ * @file stats.c
+ * @category Implementation source code
+ * @brief
+ *      Implementation from `stats.h` interface. The records of finished
+ * processes are kept in a growable array; percentiles are exact, computed
+ * on sorted copies at report time.
+ */
+#include "stats.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+static struct stats_record_t *records = NULL;
+static int nr_records = 0;
+static int cap_records = 0;
+static int stats_nr_cpus = 0;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void
+stats_init (int num_cpus)
+{
+    stats_finish ();
+    stats_nr_cpus = num_cpus;
+}
+
+void
+stats_finish (void)
+{
+    pthread_mutex_lock (&stats_lock);
+    free (records);
+    records = NULL;
+    nr_records = cap_records = 0;
+    pthread_mutex_unlock (&stats_lock);
+}
+
+void
+stats_arrive (struct pcb_t *proc, uint64_t now)
+{
+    memset (&proc->stats, 0, sizeof (proc->stats));
+    proc->stats.arrival = now;
+    proc->stats.ready_since = now;
+}
+
+void
+stats_dispatch (int cpu, struct pcb_t *proc, uint64_t now)
+{
+    if (proc->stats.dispatches == 0)
+        proc->stats.first_run = now;
+    proc->stats.dispatches++;
+    proc->stats.wait += now - proc->stats.ready_since;
+}
+
+void
+stats_put (struct pcb_t *proc, uint64_t now)
+{
+    proc->stats.ready_since = now;
+}
+
+void
+stats_exit (int cpu, struct pcb_t *proc, uint64_t now)
+{
+    struct stats_record_t rec;
+
+    rec.pid = proc->pid;
+#ifdef MLQ_SCHED
+    rec.prio = proc->prio;
+    rec.deadline = proc->deadline;
+#else
+    rec.prio = proc->priority;
+    rec.deadline = 0;
+#endif
+    rec.cpu = cpu;
+    rec.arrival = proc->stats.arrival;
+    rec.first_run = proc->stats.first_run;
+    rec.finish = now;
+    rec.wait = proc->stats.wait;
+    rec.response = proc->stats.first_run - proc->stats.arrival;
+    rec.turnaround = now - proc->stats.arrival;
+    rec.dispatches = proc->stats.dispatches;
+    rec.slots = proc->stats.slots;
+    rec.insts = proc->stats.insts;
+
+    pthread_mutex_lock (&stats_lock);
+    if (nr_records == cap_records)
+        {
+            int cap = cap_records ? cap_records * 2 : 64;
+            struct stats_record_t *grown
+                = realloc (records, sizeof (struct stats_record_t) * cap);
+            if (grown == NULL)
+                {
+                    pthread_mutex_unlock (&stats_lock);
+                    return; // statistics are best effort
+                }
+            records = grown;
+            cap_records = cap;
+        }
+    records[nr_records++] = rec;
+    pthread_mutex_unlock (&stats_lock);
+}
+
+uint64_t
+stats_percentile (const uint64_t *sorted, int n, int p)
+{
+    int rank;
+
+    if (n == 0)
+        return 0;
+    rank = (p * n + 99) / 100; // ceil (p / 100 * n)
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static int
+cmp_u64 (const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Gather the field at `offset` of the records matching the group */
+static int
+stats_collect (uint64_t *out, size_t offset, int by_cpu, int key)
+{
+    int i, n = 0;
+
+    for (i = 0; i < nr_records; i++)
+        {
+            if ((by_cpu ? records[i].cpu : (int)records[i].prio) != key)
+                continue;
+            out[n++] = *(const uint64_t *)((const char *)&records[i] + offset);
+        }
+    qsort (out, n, sizeof (uint64_t), cmp_u64);
+    return n;
+}
+
+static void
+stats_report_group (FILE *out, uint64_t *buf, int by_cpu, int key)
+{
+    static const size_t fields[] = {
+        offsetof (struct stats_record_t, wait),
+        offsetof (struct stats_record_t, response),
+        offsetof (struct stats_record_t, turnaround),
+    };
+    int f, n = 0;
+
+    fprintf (out, "%4s %4d", by_cpu ? "CPU" : "PRIO", key);
+    for (f = 0; f < 3; f++)
+        {
+            n = stats_collect (buf, fields[f], by_cpu, key);
+            fprintf (out, "  %5llu %5llu %5llu",
+                     (unsigned long long)stats_percentile (buf, n, 50),
+                     (unsigned long long)stats_percentile (buf, n, 90),
+                     (unsigned long long)stats_percentile (buf, n, 99));
+        }
+    fprintf (out, "  %4d\n", n);
+}
+
+void
+stats_report (FILE *out)
+{
+    uint64_t *buf;
+    int i, prio, cpu;
+    int nr_deadlines = 0, nr_missed = 0;
+    uint64_t slots = 0, insts = 0;
+
+    pthread_mutex_lock (&stats_lock);
+    if (nr_records == 0)
+        {
+            pthread_mutex_unlock (&stats_lock);
+            return;
+        }
+    buf = malloc (sizeof (uint64_t) * nr_records);
+    fprintf (out, "Scheduling statistics, in slots (p50 p90 p99):\n");
+    fprintf (out, "%9s  %17s  %17s  %17s  %4s\n", "", "wait", "response",
+             "turnaround", "n");
+    for (prio = 0; prio < MAX_PRIO; prio++)
+        for (i = 0; i < nr_records; i++)
+            if ((int)records[i].prio == prio)
+                {
+                    stats_report_group (out, buf, 0, prio);
+                    break;
+                }
+    for (cpu = 0; cpu < stats_nr_cpus; cpu++)
+        stats_report_group (out, buf, 1, cpu);
+    for (i = 0; i < nr_records; i++)
+        if (records[i].deadline != 0)
+            {
+                nr_deadlines++;
+                nr_missed += records[i].finish > records[i].deadline;
+            }
+    if (nr_deadlines != 0)
+        fprintf (out, "Deadlines: %d missed of %d\n", nr_missed,
+                 nr_deadlines);
+    for (i = 0; i < nr_records; i++)
+        {
+            slots += records[i].slots;
+            insts += records[i].insts;
+        }
+    fprintf (out, "Executed: %llu instructions in %llu slots\n",
+             (unsigned long long)insts, (unsigned long long)slots);
+    free (buf);
+    pthread_mutex_unlock (&stats_lock);
+}
+
+int
+stats_write_csv (const char *path)
+{
+    FILE *file;
+    int i;
+
+    if ((file = fopen (path, "w")) == NULL)
+        return -1;
+    fprintf (file, "pid,prio,cpu,arrival,first_run,finish,wait,response,"
+                   "turnaround,dispatches,slots,insts,deadline\n");
+    pthread_mutex_lock (&stats_lock);
+    for (i = 0; i < nr_records; i++)
+        fprintf (file,
+                 "%u,%u,%d,%llu,%llu,%llu,%llu,%llu,%llu,%u,%u,%llu,%llu\n",
+                 records[i].pid, records[i].prio, records[i].cpu,
+                 (unsigned long long)records[i].arrival,
+                 (unsigned long long)records[i].first_run,
+                 (unsigned long long)records[i].finish,
+                 (unsigned long long)records[i].wait,
+                 (unsigned long long)records[i].response,
+                 (unsigned long long)records[i].turnaround,
+                 records[i].dispatches, records[i].slots,
+                 (unsigned long long)records[i].insts,
+                 (unsigned long long)records[i].deadline);
+    pthread_mutex_unlock (&stats_lock);
+    fclose (file);
+    return 0;
+}
@@ -1,90 +1,374 @@
 /**
  * @file timer.c
  * @category Implementation source code
- * @brief 
+ * @brief
  *      Belongs to the entire OS.
+ *
+ *      The slots are delimited by a sense-reversing barrier. In every slot,
+ * the timer waits for `pending` running devices to arrive, then it releases
+ * the devices due in the next slot by bumping the generation `sense`. Both
+ * sides spin a little on the shared word, then sleep on it with a futex, so
+ * a slot costs two futex wake-ups in all instead of two mutex/condvar round
+ * trips per device.
+ *
+ *      Future events sit on a hierarchical timing wheel: level `l` has
+ * TIMER_WHEEL_SIZE buckets of TIMER_WHEEL_SIZE^l slots each. Arming and
+ * cancelling is a list operation. When the level below wraps around, the
+ * next bucket of a level is cascaded, i.e. its events are armed again on
+ * the finer levels, so each event moves at most TIMER_WHEEL_LEVELS times.
+ * The timer fires the events of a slot at its boundary, when no device
+ * runs, and skips the empty slots up to the earliest event.
  */
 #include "timer.h"
+#include "log.h"
+#include <limits.h>
+#include <linux/futex.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 static pthread_t _timer;
 
-struct timer_id_container_t
-{
-    struct timer_id_t id;
-    struct timer_id_container_t *next;
-};
+/* Attached devices, each on its own cache line */
+static struct timer_id_t devices[TIMER_MAX_DEVICES];
+static int nr_devices = 0;
 
-static struct timer_id_container_t *dev_list = NULL;
+/* The shared words of the barrier, on separate cache lines as well */
+static struct
+{
+    uint32_t value;
+} __attribute__ ((aligned (TIMER_CACHE_LINE))) pending, sense;
 
 static uint64_t _time;
 
+/* Bucket heads of the wheel, and the next slot whose events fire */
+static struct timer_event_t wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SIZE];
+static uint64_t wheel_time = 0;
+static pthread_mutex_t wheel_lock = PTHREAD_MUTEX_INITIALIZER;
+
 static int timer_started = 0;
-static int timer_stop = 0;
+static int timer_spin = 0; // TIMER_SPIN, or 0 when spinning can not help
 
-static void *
-timer_routine (void *args)
+static void
+futex_wait (uint32_t *addr, uint32_t value)
+{
+    syscall (SYS_futex, addr, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+static void
+futex_wake (uint32_t *addr)
 {
-    while (!timer_stop)
+    syscall (SYS_futex, addr, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+/* Wait until `*addr` is no longer `value`: spin, then sleep */
+static void
+wait_change (uint32_t *addr, uint32_t value)
+{
+    int spin;
+
+    for (spin = 0; spin < timer_spin; spin++)
         {
-            printf ("Time slot %3llu\n", current_time ());
-            int fsh = 0;
-            int event = 0;
-            /* Wait for all devices have done the job in current
-             * time slot */
-            struct timer_id_container_t *temp;
-            for (temp = dev_list; temp != NULL; temp = temp->next)
+            if (__atomic_load_n (addr, __ATOMIC_ACQUIRE) != value)
+                return;
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause ();
+#endif
+        }
+    while (__atomic_load_n (addr, __ATOMIC_ACQUIRE) == value)
+        futex_wait (addr, value);
+}
+
+/* Whether the device must resume in the current slot */
+static int
+due (struct timer_id_t *id)
+{
+    return id->wake == 0 || id->wake == TIMER_WAKE_IDLE || id->wake <= _time;
+}
+
+/* Bits of the slot number which index level `level` */
+static int
+wheel_index (uint64_t slot, int level)
+{
+    return (slot >> (level * TIMER_WHEEL_BITS)) & (TIMER_WHEEL_SIZE - 1);
+}
+
+static int
+bucket_empty (struct timer_event_t *head)
+{
+    return head->next == NULL || head->next == head;
+}
+
+/* Append `event` to the bucket of its slot, `wheel_lock` must be held */
+static void
+wheel_add (struct timer_event_t *event)
+{
+    uint64_t slot = event->expires < wheel_time ? wheel_time : event->expires;
+    uint64_t delta = slot - wheel_time;
+    struct timer_event_t *head;
+    int level = 0;
+
+    while (level < TIMER_WHEEL_LEVELS - 1
+           && delta >> ((level + 1) * TIMER_WHEEL_BITS) != 0)
+        level++;
+    /* Farther than the wheel: park it in the last bucket, it is armed
+     * again when that bucket is cascaded */
+    if (delta >> (TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS) != 0)
+        slot = wheel_time
+               + ((uint64_t)1 << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS)) - 1;
+
+    head = &wheel[level][wheel_index (slot, level)];
+    if (head->next == NULL)
+        head->next = head->prev = head;
+    event->next = head;
+    event->prev = head->prev;
+    head->prev->next = event;
+    head->prev = event;
+}
+
+static void
+wheel_del (struct timer_event_t *event)
+{
+    event->prev->next = event->next;
+    event->next->prev = event->prev;
+    event->next = event->prev = NULL;
+}
+
+/* Arm again the events of the current bucket of `level`, return its index */
+static int
+wheel_cascade (int level)
+{
+    int index = wheel_index (wheel_time, level);
+    struct timer_event_t *head = &wheel[level][index];
+
+    while (!bucket_empty (head))
+        {
+            struct timer_event_t *event = head->next;
+            wheel_del (event);
+            wheel_add (event);
+        }
+    return index;
+}
+
+void
+schedule_event (struct timer_event_t *event, uint64_t slot,
+                void (*fn) (void *), void *arg)
+{
+    pthread_mutex_lock (&wheel_lock);
+    if (event->next != NULL)
+        wheel_del (event);
+    event->expires = slot;
+    event->fn = fn;
+    event->arg = arg;
+    wheel_add (event);
+    pthread_mutex_unlock (&wheel_lock);
+}
+
+void
+cancel_event (struct timer_event_t *event)
+{
+    pthread_mutex_lock (&wheel_lock);
+    if (event->next != NULL)
+        wheel_del (event);
+    pthread_mutex_unlock (&wheel_lock);
+}
+
+/* Fire the events up to the current slot */
+static void
+expire_events (void)
+{
+    pthread_mutex_lock (&wheel_lock);
+    while (wheel_time <= _time)
+        {
+            int level = 0;
+            struct timer_event_t *head;
+
+            /* Refill the finer levels each time the one below wraps */
+            while (level < TIMER_WHEEL_LEVELS - 1
+                   && wheel_index (wheel_time, level) == 0
+                   && wheel_cascade (level + 1) == 0)
+                level++;
+
+            head = &wheel[0][wheel_index (wheel_time, 0)];
+            while (!bucket_empty (head))
                 {
-                    pthread_mutex_lock (&temp->id.event_lock);
-                    while (!temp->id.done && !temp->id.fsh)
-                        {
-                            pthread_cond_wait (&temp->id.event_cond,
-                                               &temp->id.event_lock);
-                        }
-                    if (temp->id.fsh)
-                        {
-                            fsh++;
-                        }
-                    event++;
-                    pthread_mutex_unlock (&temp->id.event_lock);
+                    struct timer_event_t *event = head->next;
+                    wheel_del (event);
+                    pthread_mutex_unlock (&wheel_lock);
+                    event->fn (event->arg);
+                    pthread_mutex_lock (&wheel_lock);
                 }
+            wheel_time++;
+        }
+    pthread_mutex_unlock (&wheel_lock);
+}
+
+/* Slot of the earliest pending event, UINT64_MAX if none */
+static uint64_t
+next_event (void)
+{
+    uint64_t next = UINT64_MAX;
+    int level, i;
 
-            /* Increase the time slot */
+    pthread_mutex_lock (&wheel_lock);
+    /* Per level, the buckets in order from the current one cover later
+     * and later slots, the first non empty one holds the earliest. The
+     * current bucket comes last if it has been cascaded already, i.e. the
+     * levels below have moved on from 0 */
+    for (level = 0; level < TIMER_WHEEL_LEVELS; level++)
+        {
+            uint64_t below
+                = wheel_time
+                  & (((uint64_t)1 << (level * TIMER_WHEEL_BITS)) - 1);
+            int first = wheel_index (wheel_time, level) + (below != 0);
+
+            for (i = 0; i < TIMER_WHEEL_SIZE; i++)
+                {
+                    int index = (first + i) & (TIMER_WHEEL_SIZE - 1);
+                    struct timer_event_t *head = &wheel[level][index];
+                    struct timer_event_t *event;
+
+                    if (bucket_empty (head))
+                        continue;
+                    for (event = head->next; event != head;
+                         event = event->next)
+                        if (event->expires < next)
+                            next = event->expires;
+                    break;
+                }
+        }
+    pthread_mutex_unlock (&wheel_lock);
+    return next < wheel_time ? wheel_time : next;
+}
+
+/**
+ * @brief
+ *      Begin the next slot. When `skip_to` is later, nobody runs until then:
+ * go through the empty slots, the log stays the same.
+ */
+static void
+advance (uint64_t skip_to)
+{
+    do
+        {
             _time++;
+            log_set_slot (_time);
+            log_printf (LOG_INFO, "Time slot %3llu\n",
+                        (unsigned long long)current_time ());
+        }
+    while (_time < skip_to);
+    expire_events ();
+}
+
+static void *
+timer_routine (void *args)
+{
+    while (1)
+        {
+            int fsh = 0;
+            int busy = 0;                   // devices running next slot
+            int resumed = 0;                // devices released next slot
+            uint64_t next_wake = UINT64_MAX; // earliest sleeping device
+            uint32_t pend;
+            int i;
+
+            /* Wait for all devices have done the job in current time
+             * slot. A sleeping device is already done. */
+            while ((pend = __atomic_load_n (&pending.value, __ATOMIC_ACQUIRE))
+                   != 0)
+                wait_change (&pending.value, pend);
 
-            /* Let devices continue their job */
-            for (temp = dev_list; temp != NULL; temp = temp->next)
+            for (i = 0; i < nr_devices; i++)
                 {
-                    pthread_mutex_lock (&temp->id.timer_lock);
-                    temp->id.done = 0;
-                    pthread_cond_signal (&temp->id.timer_cond);
-                    pthread_mutex_unlock (&temp->id.timer_lock);
+                    struct timer_id_t *id = &devices[i];
+                    if (id->fsh)
+                        fsh++;
+                    else if (id->wake == 0)
+                        busy++;
+                    else if (id->wake < next_wake)
+                        next_wake = id->wake; // or TIMER_WAKE_IDLE
                 }
-            if (fsh == event)
+
+            if (fsh == nr_devices)
                 {
                     break;
                 }
+
+            /* Increase the time slot, and fire its events */
+            if (!busy)
+                {
+                    uint64_t event = next_event ();
+                    if (event < next_wake)
+                        next_wake = event;
+                }
+            advance (busy || next_wake == TIMER_WAKE_IDLE ? 0 : next_wake);
+
+            /* Let devices continue their job: mark the due ones, count
+             * them as pending, then flip the generation */
+            uint32_t gen
+                = __atomic_load_n (&sense.value, __ATOMIC_RELAXED) + 1;
+            for (i = 0; i < nr_devices; i++)
+                if (!devices[i].fsh && due (&devices[i]))
+                    {
+                        __atomic_store_n (&devices[i].release, gen,
+                                          __ATOMIC_RELAXED);
+                        resumed++;
+                    }
+            __atomic_store_n (&pending.value, resumed, __ATOMIC_RELAXED);
+            __atomic_store_n (&sense.value, gen, __ATOMIC_RELEASE);
+            futex_wake (&sense.value);
         }
     pthread_exit (args);
 }
 
-void
-next_slot (struct timer_id_t *timer_id)
+/* Tell the timer this device is done with the current slot */
+static void
+arrive (void)
+{
+    if (__atomic_sub_fetch (&pending.value, 1, __ATOMIC_ACQ_REL) == 0)
+        futex_wake (&pending.value);
+}
+
+/* Tell the timer we are done, and wait until it resumes us at `wake` */
+static void
+wait_slot (struct timer_id_t *timer_id, uint64_t wake)
 {
-    /* Tell timer that we have done our job in current slot */
-    pthread_mutex_lock (&timer_id->event_lock);
-    timer_id->done = 1;
-    pthread_cond_signal (&timer_id->event_cond);
-    pthread_mutex_unlock (&timer_id->event_lock);
+    uint32_t arrived = __atomic_load_n (&sense.value, __ATOMIC_ACQUIRE);
+    uint32_t gen;
 
-    /* Wait for going to next slot */
-    pthread_mutex_lock (&timer_id->timer_lock);
-    while (timer_id->done)
+    timer_id->wake = wake;
+    arrive ();
+
+    /* Every flip of the generation wakes all the waiters up, the ones
+     * which are not released yet, e.g. asleep, wait again */
+    while (1)
         {
-            pthread_cond_wait (&timer_id->timer_cond, &timer_id->timer_lock);
+            gen = __atomic_load_n (&sense.value, __ATOMIC_ACQUIRE);
+            if (gen != arrived
+                && __atomic_load_n (&timer_id->release, __ATOMIC_RELAXED)
+                       == gen)
+                break;
+            wait_change (&sense.value, gen);
         }
-    pthread_mutex_unlock (&timer_id->timer_lock);
+}
+
+void
+next_slot (struct timer_id_t *timer_id)
+{
+    wait_slot (timer_id, 0);
+}
+
+void
+idle_slot (struct timer_id_t *timer_id)
+{
+    wait_slot (timer_id, TIMER_WAKE_IDLE);
+}
+
+void
+sleep_until (struct timer_id_t *timer_id, uint64_t slot)
+{
+    wait_slot (timer_id, slot > current_time () + 1 ? slot : 0);
 }
 
 uint64_t
@@ -93,9 +377,38 @@ current_time ()
     return _time;
 }
 
+void
+start_clock ()
+{
+    log_set_slot (_time);
+    log_printf (LOG_INFO, "Time slot %3llu\n",
+                (unsigned long long)current_time ());
+    expire_events ();
+}
+
+void
+step_time (int idle)
+{
+    uint64_t next = idle ? next_event () : 0;
+
+    advance (next == UINT64_MAX ? 0 : next);
+}
+
 void
 start_timer ()
 {
+    uint32_t gen = sense.value + 1;
+    int i;
+
+    start_clock ();
+    /* On a single processor, the thread we spin for can not run */
+    timer_spin = sysconf (_SC_NPROCESSORS_ONLN) > 1 ? TIMER_SPIN : 0;
+    /* Every device runs the first slot */
+    for (i = 0; i < nr_devices; i++)
+        devices[i].release = gen;
+    pending.value = nr_devices;
+    __atomic_store_n (&sense.value, gen, __ATOMIC_RELEASE);
+    futex_wake (&sense.value);
     timer_started = 1;
     pthread_create (&_timer, NULL, timer_routine, NULL);
 }
@@ -103,57 +416,47 @@ start_timer ()
 void
 detach_event (struct timer_id_t *event)
 {
-    pthread_mutex_lock (&event->event_lock);
     event->fsh = 1;
-    pthread_cond_signal (&event->event_cond);
-    pthread_mutex_unlock (&event->event_lock);
+    arrive ();
 }
 
 struct timer_id_t *
 attach_event ()
 {
-    if (timer_started)
-        {
-            return NULL;
-        }
-    else
+    struct timer_id_t *id = NULL;
+    int i;
+
+    /* Once started, reuse the device of a detached thread if any */
+    for (i = 0; timer_started && i < nr_devices && id == NULL; i++)
+        if (devices[i].fsh)
+            id = &devices[i];
+    if (id == NULL)
         {
-            struct timer_id_container_t *container
-                = (struct timer_id_container_t *)malloc (
-                    sizeof (struct timer_id_container_t));
-            container->id.done = 0;
-            container->id.fsh = 0;
-            pthread_cond_init (&container->id.event_cond, NULL);
-            pthread_mutex_init (&container->id.event_lock, NULL);
-            pthread_cond_init (&container->id.timer_cond, NULL);
-            pthread_mutex_init (&container->id.timer_lock, NULL);
-            if (dev_list == NULL)
-                {
-                    dev_list = container;
-                    dev_list->next = NULL;
-                }
-            else
-                {
-                    container->next = dev_list;
-                    dev_list = container;
-                }
-            return &(container->id);
+            if (nr_devices == TIMER_MAX_DEVICES)
+                return NULL;
+            id = &devices[nr_devices++];
         }
+    id->fsh = 0;
+    id->wake = 0;
+    /* Neither the current generation nor the next: the device joins when
+     * the timer releases it, see join_slot() */
+    id->release = __atomic_load_n (&sense.value, __ATOMIC_RELAXED) - 1;
+    return id;
+}
+
+void
+join_slot (struct timer_id_t *timer_id)
+{
+    uint32_t gen;
+
+    while ((gen = __atomic_load_n (&sense.value, __ATOMIC_ACQUIRE))
+           != __atomic_load_n (&timer_id->release, __ATOMIC_RELAXED))
+        wait_change (&sense.value, gen);
 }
 
 void
 stop_timer ()
 {
-    timer_stop = 1;
     pthread_join (_timer, NULL);
-    while (dev_list != NULL)
-        {
-            struct timer_id_container_t *temp = dev_list;
-            dev_list = dev_list->next;
-            pthread_cond_destroy (&temp->id.event_cond);
-            pthread_mutex_destroy (&temp->id.event_lock);
-            pthread_cond_destroy (&temp->id.timer_cond);
-            pthread_mutex_destroy (&temp->id.timer_lock);
-            free (temp);
-        }
+    nr_devices = 0;
 }
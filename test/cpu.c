@@ -0,0 +1,383 @@
+/**
+ * @file cpu.c
+ * @brief
+ *      Unit-test and benchmark for the dispatch loop of the CPU
+ *      (implemented in cpu.c and interface in cpu.h)
+ *
+ */
+
+#include "../include/cpu.h"
+#include "../include/loader.h"
+#include "../include/log.h"
+#include "../include/mm.h"
+#include "../ext/munit.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Utilities */
+
+#define BENCH_CALC_OPS 2000000
+#define BENCH_MEM_LOOPS 20000 // write + read pairs
+
+static double
+elapsed_ns (struct timespec *start, struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e9
+           + (end->tv_nsec - start->tv_nsec);
+}
+
+/* A process running `size` instructions, all CALC unless set after */
+static struct pcb_t *
+new_proc (uint32_t size)
+{
+    struct code_seg_t *code = malloc (sizeof (struct code_seg_t));
+
+    code->text = calloc (size, sizeof (struct inst_t));
+    code->size = size;
+    code->ops = NULL;
+    return create_pcb (1, 0, code, 0, NULL, 0);
+}
+
+static void
+free_proc (struct pcb_t *proc)
+{
+    free (proc->code->text);
+    free (proc->code->ops);
+    free (proc->code);
+    destroy_pcb (proc);
+}
+
+static void
+set_inst (struct pcb_t *proc, uint32_t i, enum ins_opcode_t opcode,
+          uint32_t arg_0, uint32_t arg_1, uint32_t arg_2)
+{
+    proc->code->text[i].opcode = opcode;
+    proc->code->text[i].arg_0 = arg_0;
+    proc->code->text[i].arg_1 = arg_1;
+    proc->code->text[i].arg_2 = arg_2;
+}
+
+/* Definition of test funcs */
+
+/*
+    This func tests how run_ops() and run() move through the code:
+        - run_ops() stops after `budget` instructions, or at the end of the
+          code, and says how many it has run
+        - run() runs one, and returns 1 at the end
+        - An unknown opcode is skipped
+*/
+MunitResult
+budget (const MunitParameter params[], void *user_data_or_fixture)
+{
+    struct pcb_t *proc = new_proc (6);
+
+    proc->code->text[2].opcode = (enum ins_opcode_t)42;
+    if (run_ops (proc, 3) != 3 || proc->pc != 3)
+        return MUNIT_FAIL;
+    if (run (proc) != 0 || proc->pc != 4)
+        return MUNIT_FAIL;
+    if (run_ops (proc, 10) != 2 || proc->pc != 6)
+        return MUNIT_FAIL;
+    if (run_ops (proc, 10) != 0 || run (proc) != 1 || proc->pc != 6)
+        return MUNIT_FAIL;
+    free_proc (proc);
+    return MUNIT_OK; // Pass all requirements
+}
+
+/*
+    This func tests the memory instructions through the dispatch loop, with
+    paging:
+        - A value written to a region is read back into another one
+        - The read stores the value at offset 0 of its destination
+*/
+MunitResult
+memory (const MunitParameter params[], void *user_data_or_fixture)
+{
+    struct memphy_struct mram, mswp;
+    struct memphy_struct *mswps[1] = { &mswp };
+    struct pcb_t *proc = new_proc (4);
+    BYTE data;
+
+    log_set_level (LOG_ERROR);
+    init_memphy (&mram, 1 << 20, 1);
+    init_memphy (&mswp, 1 << 20, 1);
+    proc->mm = malloc (sizeof (struct mm_struct));
+    init_mm (proc->mm, proc);
+    proc->mram = &mram;
+    proc->mswp = mswps;
+    proc->active_mswp = &mswp;
+
+    set_inst (proc, 0, ALLOC, 300, 0, 0);
+    set_inst (proc, 1, ALLOC, 300, 1, 0);
+    set_inst (proc, 2, WRITE, 100 + 256, 0, 20); // the data is a BYTE
+    set_inst (proc, 3, READ, 0, 20, 1);
+    if (run_ops (proc, 4) != 4)
+        return MUNIT_FAIL;
+    if (__read (proc, 0, 1, 0, &data) != 0 || data != 100)
+        return MUNIT_FAIL;
+    return MUNIT_OK;
+}
+
+/* Write `text` to a temporary file, and load it */
+static struct pcb_t *
+load_text (const char *text)
+{
+    char path[] = "/tmp/cpu_test_XXXXXX";
+    int fd = mkstemp (path);
+    struct pcb_t *proc;
+    FILE *file;
+
+    if (fd < 0 || (file = fdopen (fd, "w")) == NULL)
+        return NULL;
+    fputs (text, file);
+    fclose (file);
+    proc = load (path);
+    remove (path);
+    return proc;
+}
+
+/*
+    This func tests the fusion of the loader:
+        - Runs of CALCs, and of WRITEs to the same region, are fused, each
+          instruction knows how many are left in its run
+        - A budget ending inside a run stops there, and every instruction
+          of the run counts as one
+*/
+MunitResult
+fused (const MunitParameter params[], void *user_data_or_fixture)
+{
+    static const uint32_t runs[] = { 2, 1, 1, 1, 3, 2, 1, 1, 1 };
+    struct memphy_struct mram, mswp;
+    struct memphy_struct *mswps[1] = { &mswp };
+    struct pcb_t *proc = load_text ("1 9\ncalc\ncalc\nalloc 300 0\n"
+                                    "alloc 300 1\nwrite 7 0 1\n"
+                                    "write 8 0 2\nwrite 9 0 3\n"
+                                    "write 5 1 1\nread 0 2 1\n");
+    BYTE data;
+    uint32_t i;
+
+    if (proc == NULL)
+        return MUNIT_FAIL;
+    for (i = 0; i < 9; i++)
+        if (proc->code->ops[i].run != runs[i])
+            return MUNIT_FAIL;
+
+    log_set_level (LOG_ERROR);
+    init_memphy (&mram, 1 << 20, 1);
+    init_memphy (&mswp, 1 << 20, 1);
+    proc->mm = malloc (sizeof (struct mm_struct));
+    init_mm (proc->mm, proc);
+    proc->mram = &mram;
+    proc->mswp = mswps;
+    proc->active_mswp = &mswp;
+
+    if (run_ops (proc, 1) != 1 || proc->pc != 1) // inside the CALCs
+        return MUNIT_FAIL;
+    if (run_ops (proc, 4) != 4 || proc->pc != 5) // inside the WRITEs
+        return MUNIT_FAIL;
+    if (__read (proc, 0, 0, 1, &data) != 0 || data != 7
+        || __read (proc, 0, 0, 2, &data) != 0 || data != 0)
+        return MUNIT_FAIL;
+    if (run_ops (proc, 10) != 4 || proc->pc != 9)
+        return MUNIT_FAIL;
+    if (__read (proc, 0, 0, 3, &data) != 0 || data != 9
+        || __read (proc, 0, 1, 0, &data) != 0 || data != 8
+        || __read (proc, 0, 1, 1, &data) != 0 || data != 5)
+        return MUNIT_FAIL;
+    return MUNIT_OK;
+}
+
+/*
+    This func tests the control flow of the CPU:
+        - LOOP sets the counter, JNZ jumps back while it counts down, JMP
+          always jumps
+        - Each of them counts as an instruction, and a budget may end at
+          any of them
+*/
+MunitResult
+loop (const MunitParameter params[], void *user_data_or_fixture)
+{
+    /* 1 + 3 * (2 + 1) + 1 + 1 instructions */
+    struct pcb_t *proc = load_text ("1 7\nloop 3\ncalc\ncalc\njnz 1\n"
+                                    "jmp 6\ncalc\ncalc\n");
+    int ran = 0, n;
+
+    if (proc == NULL)
+        return MUNIT_FAIL;
+    while ((n = run_ops (proc, 2)) != 0)
+        ran += n;
+    if (ran != 12 || proc->pc != 7 || proc->counter != 0)
+        return MUNIT_FAIL;
+
+    proc->pc = 0;
+    if (run_ops (proc, 100) != 12 || proc->pc != 7)
+        return MUNIT_FAIL;
+    return MUNIT_OK;
+}
+
+/*
+    Instructions per second of CALC-heavy and memory-heavy programs, run
+    one instruction per call as the CPUs do with run(), and in a single
+    run_ops() call.
+*/
+static void
+bench_program (const char *name, struct pcb_t *proc)
+{
+    struct timespec start, end;
+    uint32_t size = proc->code->size;
+
+    decode (proc->code); // as the loader does
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    while (run (proc) == 0)
+        ;
+    clock_gettime (CLOCK_MONOTONIC, &end);
+    printf ("\n%-8s %12.2f Minst/s with run()", name,
+            size * 1e3 / elapsed_ns (&start, &end));
+}
+
+MunitResult
+bench_calc (const MunitParameter params[], void *user_data_or_fixture)
+{
+    struct pcb_t *proc = new_proc (BENCH_CALC_OPS);
+    struct timespec start, end;
+    char *text;
+    int i, len;
+
+    bench_program ("calc", proc);
+    proc->pc = 0;
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    run_ops (proc, BENCH_CALC_OPS);
+    clock_gettime (CLOCK_MONOTONIC, &end);
+    printf ("\n%-8s %12.2f Minst/s with run_ops()", "calc",
+            BENCH_CALC_OPS * 1e3 / elapsed_ns (&start, &end));
+    free_proc (proc);
+
+    /* The same, loaded and fused, 1000 per slot as with `clock 1000` */
+    text = malloc (16 + 5 * BENCH_CALC_OPS);
+    len = sprintf (text, "1 %d\n", BENCH_CALC_OPS);
+    for (i = 0; i < BENCH_CALC_OPS; i++)
+        len += sprintf (text + len, "calc\n");
+    proc = load_text (text);
+    free (text);
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    while (run_ops (proc, 1000) != 0)
+        ;
+    clock_gettime (CLOCK_MONOTONIC, &end);
+    printf ("\n%-8s %12.2f Minst/s fused, 1000 a run_ops() ", "calc",
+            BENCH_CALC_OPS * 1e3 / elapsed_ns (&start, &end));
+    return MUNIT_OK;
+}
+
+MunitResult
+bench_memory (const MunitParameter params[], void *user_data_or_fixture)
+{
+    struct memphy_struct mram, mswp;
+    struct memphy_struct *mswps[1] = { &mswp };
+    struct pcb_t *proc = new_proc (2 + 2 * BENCH_MEM_LOOPS);
+    int i;
+
+    log_set_level (LOG_ERROR);
+    init_memphy (&mram, 1 << 20, 1);
+    init_memphy (&mswp, 1 << 20, 1);
+    proc->mm = malloc (sizeof (struct mm_struct));
+    init_mm (proc->mm, proc);
+    proc->mram = &mram;
+    proc->mswp = mswps;
+    proc->active_mswp = &mswp;
+
+    set_inst (proc, 0, ALLOC, 1024, 0, 0);
+    set_inst (proc, 1, ALLOC, 1024, 1, 0);
+    for (i = 0; i < BENCH_MEM_LOOPS; i++)
+        {
+            set_inst (proc, 2 + 2 * i, WRITE, i, 0, i % 1000);
+            set_inst (proc, 3 + 2 * i, READ, 0, i % 1000, 1);
+        }
+    bench_program ("memory", proc);
+    printf (" ");
+    return MUNIT_OK;
+}
+
+/* Configure the test suite */
+
+MunitTest tests[]
+    = { {
+            "/budget",              /* name */
+            budget,                 /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "/memory",              /* name */
+            memory,                 /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "/fused",               /* name */
+            fused,                  /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "/loop",                /* name */
+            loop,                   /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } };
+
+MunitTest bench_tests[]
+    = { {
+            "/calc",                /* name */
+            bench_calc,             /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "/memory",              /* name */
+            bench_memory,           /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } };
+
+/* Benchmarks, not run with the tests but alone, by `./test/cpu /bench` */
+static const MunitSuite bench_suite = {
+    "/bench",               /* name */
+    bench_tests,            /* MunitTest */
+    NULL,                   /* suites */
+    1,                      /* iterations */
+    MUNIT_SUITE_OPTION_NONE /* options */
+};
+
+static const MunitSuite suite = {
+    "",                     /* name */
+    tests,                  /* MunitTest */
+    NULL,                   /* suites */
+    1,                      /* iterations */
+    MUNIT_SUITE_OPTION_NONE /* options */
+};
+
+/* Start testing */
+
+int
+main (int argc, char *argv[])
+{
+    if (argc > 1 && strncmp (argv[1], "/bench", 6) == 0)
+        return munit_suite_main (&bench_suite, NULL, argc, argv);
+    return munit_suite_main (&suite, NULL, argc, argv);
+}
@@ -322,6 +322,248 @@ priority_enqueue_dequeue (const MunitParameter params[],
     return MUNIT_OK; // Pass all requirements
 }
 
+/*
+    This func tests a queue holding far more than the initial capacity.
+        - Check `size` after every `enqueue()`
+        - Check the First-in First-out order of all elements
+*/
+MunitResult
+enqueue_many (const MunitParameter params[], void *user_data_or_fixture)
+{
+    const int n = 5000;
+    struct queue_t *q = init_queue ();
+    struct pcb_t **procs = malloc (sizeof (struct pcb_t *) * n);
+
+    for (int i = 0; i < n; i++)
+        {
+            procs[i] = create_pcb (i, 1, NULL, 0, NULL, 0); // dummy process
+            if (enqueue (q, procs[i]) != 0 || q->size != i + 1)
+                {
+                    return MUNIT_FAIL;
+                }
+        }
+
+    for (int i = 0; i < n; i++)
+        {
+            struct pcb_t *front = dequeue (q);
+            if (front == NULL || front->pid != i)
+                {
+                    return MUNIT_FAIL;
+                }
+            destroy_pcb (front);
+        }
+
+    if (!empty (q) || dequeue (q) != NULL)
+        {
+            return MUNIT_FAIL;
+        }
+
+    free (procs);
+    destroy_queue (q);
+    return MUNIT_OK; // Pass all requirements
+}
+
+/*
+    This func tests interleaved `enqueue()`s and `dequeue()`s going around the
+    ring buffer many times.
+        - Check that `proc[i]` is the i-th element from the front
+        - Check `dequeue_tail()`
+*/
+MunitResult
+wrap_around (const MunitParameter params[], void *user_data_or_fixture)
+{
+    struct queue_t *q = init_queue ();
+    struct pcb_t *procs[8];
+    int next_in = 0, next_out = 0;
+
+    for (int i = 0; i < 8; i++)
+        procs[i] = create_pcb (i, 1, NULL, 0, NULL, 0); // dummy process
+
+    for (int round = 0; round < 100; round++)
+        {
+            /* Enqueue 5, dequeue 4: the front keeps moving forward */
+            for (int i = 0; i < 5; i++, next_in++)
+                enqueue (q, procs[next_in % 8]);
+            for (int i = 0; i < 4; i++, next_out++)
+                {
+                    if (dequeue (q)->pid != next_out % 8)
+                        {
+                            return MUNIT_FAIL;
+                        }
+                }
+
+            for (int i = 0; i < q->size; i++) // contiguous view
+                {
+                    if (q->proc[i]->pid != (next_out + i) % 8)
+                        {
+                            return MUNIT_FAIL;
+                        }
+                }
+
+            if (round % 10 == 9) // keep the queue small
+                {
+                    if (dequeue_tail (q)->pid != (next_in - 1) % 8)
+                        {
+                            return MUNIT_FAIL;
+                        }
+                    next_in--;
+                }
+        }
+
+    for (int i = 0; i < 8; i++)
+        destroy_pcb (procs[i]);
+    destroy_queue (q);
+    return MUNIT_OK; // Pass all requirements
+}
+
+/*
+    This func tests `enqueue_prio()` and `dequeue_prio()`:
+        - Check the least key is dequeued first
+        - Check processes with the same key leave in FIFO order
+        - Check `peek_prio()`
+*/
+MunitResult
+heap_ties (const MunitParameter params[], void *user_data_or_fixture)
+{
+    struct queue_t *q = init_queue ();
+    struct pcb_t *procs[6];
+    uint32_t keys[6] = { 3, 1, 3, 0, 1, 3 };
+    int expected[6] = { 3, 1, 4, 0, 2, 5 }; // by key, then by arrival
+
+    for (int i = 0; i < 6; i++)
+        {
+            procs[i] = create_pcb (i, keys[i], NULL, 0, NULL, 0);
+            if (enqueue_prio (q, procs[i], keys[i]) != 0)
+                {
+                    return MUNIT_FAIL;
+                }
+        }
+
+    if (peek_prio (q) != procs[3])
+        {
+            return MUNIT_FAIL;
+        }
+
+    for (int i = 0; i < 6; i++)
+        {
+            struct pcb_t *front = dequeue_prio (q);
+            if (front == NULL || front->pid != expected[i])
+                {
+                    return MUNIT_FAIL;
+                }
+        }
+
+    if (!empty (q) || dequeue_prio (q) != NULL || peek_prio (q) != NULL)
+        {
+            return MUNIT_FAIL;
+        }
+
+    for (int i = 0; i < 6; i++)
+        destroy_pcb (procs[i]);
+    destroy_queue (q);
+    return MUNIT_OK; // Pass all requirements
+}
+
+/*
+    This func pushes 5000 processes with random keys through the heap:
+        - Check keys come out in non-decreasing order
+        - Check ties keep the arrival (pid) order
+*/
+MunitResult
+heap_many (const MunitParameter params[], void *user_data_or_fixture)
+{
+    const int n = 5000;
+    struct queue_t *q = init_queue ();
+    struct pcb_t **procs = malloc (sizeof (struct pcb_t *) * n);
+
+    for (int i = 0; i < n; i++)
+        {
+            uint32_t key = munit_rand_int_range (0, 139);
+            procs[i] = create_pcb (i, key, NULL, 0, NULL, 0);
+            if (enqueue_prio (q, procs[i], key) != 0 || q->size != i + 1)
+                {
+                    return MUNIT_FAIL;
+                }
+        }
+
+    struct pcb_t *last = NULL;
+    for (int i = 0; i < n; i++)
+        {
+            struct pcb_t *front = dequeue_prio (q);
+            if (front == NULL)
+                {
+                    return MUNIT_FAIL;
+                }
+            if (last != NULL
+                && (front->priority < last->priority
+                    || (front->priority == last->priority
+                        && front->pid < last->pid)))
+                {
+                    return MUNIT_FAIL;
+                }
+            last = front;
+        }
+
+    if (!empty (q))
+        {
+            return MUNIT_FAIL;
+        }
+
+    for (int i = 0; i < n; i++)
+        destroy_pcb (procs[i]);
+    free (procs);
+    destroy_queue (q);
+    return MUNIT_OK; // Pass all requirements
+}
+
+/*
+    This func tests `dequeue_affine()` on a wrapped ring buffer:
+        - Check the first process which last ran on the CPU is taken
+        - Check the others keep their FIFO order
+        - Check the front is taken when none is within the look-ahead
+*/
+MunitResult
+affine_lookahead (const MunitParameter params[], void *user_data_or_fixture)
+{
+    struct queue_t *q = init_queue ();
+    struct pcb_t *procs[6];
+    int expected[] = { 3, 0, 1, 2, 4, 5 };
+    int lookahead[] = { 4, 3, 1, 1, 1, 1 };
+
+    /* Wrap the ring around first */
+    for (int i = 0; i < QUEUE_INIT_CAP - 2; i++)
+        {
+            enqueue (q, procs[0] = create_pcb (99, 1, NULL, 0, NULL, 0));
+            destroy_pcb (dequeue (q));
+        }
+    for (int i = 0; i < 6; i++)
+        {
+            procs[i] = create_pcb (i, 1, NULL, 0, NULL, 0);
+            procs[i]->last_cpu = (i == 3 || i == 5) ? 1 : 0;
+            enqueue (q, procs[i]);
+        }
+
+    for (int i = 0; i < 6; i++)
+        {
+            /* pid 5 is out of reach after pid 3 is taken */
+            struct pcb_t *proc = dequeue_affine (q, 1, lookahead[i]);
+            if (proc == NULL || proc->pid != (uint32_t)expected[i]
+                || q->size != 5 - i)
+                {
+                    return MUNIT_FAIL;
+                }
+            if (i == 0 && (q->proc[0]->pid != 0 || q->proc[2]->pid != 2))
+                {
+                    return MUNIT_FAIL;
+                }
+        }
+
+    for (int i = 0; i < 6; i++)
+        destroy_pcb (procs[i]);
+    destroy_queue (q);
+    return MUNIT_OK; // Pass all requirements
+}
+
 /* Configure testcases */
 
 MunitTest tests[]
@@ -382,6 +624,47 @@ MunitTest tests[]
             NULL                    /* parameters to the test func */
         },
 
+        {
+            "[7] Enqueue and dequeue 5000 elements: ", /* name of the test */
+            enqueue_many,                              /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "[8] Ring buffer wrap around: ", /* name of the test */
+            wrap_around,                     /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "[9] Heap order with ties: ", /* name of the test */
+            heap_ties,                    /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "[10] Heap with 5000 random keys: ", /* name of the test */
+            heap_many,                           /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "[11] Affine dequeue with look-ahead: ", /* name of the test */
+            affine_lookahead,                        /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+
         { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } };
 
 /* Configure the test suite */
@@ -0,0 +1,212 @@
+/**
+ * @file rbtree.c
+ * @brief
+ *      Unit-test for the red-black tree.
+ *
+ */
+
+#include "../include/rbtree.h"
+#include "../ext/munit.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Utilities */
+
+struct item_t
+{
+    int key;
+    int seq; // insertion order
+    struct rb_node_t node;
+};
+
+static int
+item_less (const struct rb_node_t *a, const struct rb_node_t *b)
+{
+    return rb_entry (a, struct item_t, node)->key
+           < rb_entry (b, struct item_t, node)->key;
+}
+
+/*
+    Check the red-black properties below `node`.
+    Return its black height, -1 if a property is broken.
+*/
+static int
+check_subtree (const struct rb_node_t *node)
+{
+    if (node == NULL)
+        return 1;
+    if (node->color == RB_RED
+        && ((node->left && node->left->color == RB_RED)
+            || (node->right && node->right->color == RB_RED)))
+        return -1;
+    if ((node->left && node->left->parent != node)
+        || (node->right && node->right->parent != node))
+        return -1;
+
+    int left = check_subtree (node->left);
+    int right = check_subtree (node->right);
+    if (left < 0 || left != right)
+        return -1;
+    return left + (node->color == RB_BLACK);
+}
+
+/*
+    Check the tree is balanced, in order (FIFO among equal keys), holds
+    `size` nodes, and caches its leftmost node.
+*/
+static int
+check_tree (const struct rb_tree_t *tree, int size)
+{
+    const struct rb_node_t *node;
+    const struct item_t *last = NULL;
+    int count = 0;
+
+    if (tree->root != NULL
+        && (tree->root->color != RB_BLACK || tree->root->parent != NULL))
+        return 0;
+    if (check_subtree (tree->root) < 0)
+        return 0;
+
+    node = tree->root;
+    while (node != NULL && node->left != NULL)
+        node = node->left;
+    if (node != rb_first (tree))
+        return 0;
+
+    for (; node != NULL; node = rb_next (node), count++)
+        {
+            const struct item_t *item = rb_entry (node, struct item_t, node);
+            if (last != NULL
+                && (item->key < last->key
+                    || (item->key == last->key && item->seq < last->seq)))
+                return 0;
+            last = item;
+        }
+    return count == size;
+}
+
+/* Definition of test funcs */
+
+/*
+    This func tests `rb_insert()`, `rb_first()` and `rb_next()`:
+        - Check that the nodes come out in order
+        - Check that equal keys keep their insertion order
+*/
+MunitResult
+insert_order (const MunitParameter params[], void *user_data_or_fixture)
+{
+    struct rb_tree_t tree = { NULL, NULL };
+    struct item_t items[8];
+    int keys[8] = { 5, 3, 8, 3, 1, 5, 9, 3 };
+
+    if (rb_first (&tree) != NULL)
+        {
+            return MUNIT_FAIL;
+        }
+
+    for (int i = 0; i < 8; i++)
+        {
+            items[i].key = keys[i];
+            items[i].seq = i;
+            rb_insert (&tree, &items[i].node, item_less);
+            if (!check_tree (&tree, i + 1))
+                {
+                    return MUNIT_FAIL;
+                }
+        }
+
+    if (rb_first (&tree) != &items[4].node) // key 1
+        {
+            return MUNIT_FAIL;
+        }
+    return MUNIT_OK; // Pass all requirements
+}
+
+/*
+    This func inserts and erases 2000 random nodes:
+        - Check the red-black properties after every operation
+        - Check the cached leftmost node when the first node is erased
+*/
+MunitResult
+insert_erase_many (const MunitParameter params[],
+                   void *user_data_or_fixture)
+{
+    const int n = 2000;
+    struct rb_tree_t tree = { NULL, NULL };
+    struct item_t *items = malloc (sizeof (struct item_t) * n);
+    int size = 0;
+
+    for (int i = 0; i < n; i++)
+        {
+            items[i].key = munit_rand_int_range (0, 99);
+            items[i].seq = i;
+            rb_insert (&tree, &items[i].node, item_less);
+            size++;
+            if (i % 3 == 2) // erase an older node
+                {
+                    int victim = munit_rand_int_range (0, i);
+                    if (items[victim].seq >= 0)
+                        {
+                            rb_erase (&tree, &items[victim].node);
+                            items[victim].seq = -1;
+                            size--;
+                        }
+                }
+            if (!check_tree (&tree, size))
+                {
+                    return MUNIT_FAIL;
+                }
+        }
+
+    while (rb_first (&tree) != NULL) // drain from the left
+        {
+            rb_erase (&tree, rb_first (&tree));
+            size--;
+            if (!check_tree (&tree, size))
+                {
+                    return MUNIT_FAIL;
+                }
+        }
+
+    free (items);
+    return size == 0 ? MUNIT_OK : MUNIT_FAIL;
+}
+
+/* Configure testcases */
+
+MunitTest tests[]
+    = { {
+            "[0] Insert in order: ", /* name of the test */
+            insert_order,            /* test func */
+            NULL,                    /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "[1] Insert and erase 2000 nodes: ", /* name of the test */
+            insert_erase_many,                   /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } };
+
+/* Configure the test suite */
+
+static const MunitSuite suite = {
+    "",                     /* name */
+    tests,                  /* MunitTest */
+    NULL,                   /* suites */
+    1,                      /* iterations */
+    MUNIT_SUITE_OPTION_NONE /* options */
+};
+
+/* Start testing */
+
+int
+main (int argc, char *argv[])
+{
+    return munit_suite_main (&suite, NULL, argc, argv);
+}
@@ -8,9 +8,27 @@
  */
 
 #include "../include/sched.h"
+#include "../include/mpmc.h"
+#include "../include/queue.h"
 #include "../ext/munit.h"
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Utilities */
+
+#define BENCH_ROUNDS 200000
+#define BENCH_CONTENTION_OPS 20000 // enqueue + dequeue pairs per thread
+#define BENCH_MAX_THREADS 64
+
+static double
+elapsed_ns (struct timespec *start, struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e9
+           + (end->tv_nsec - start->tv_nsec);
+}
 
 MunitResult
 init_finish (const MunitParameter params[], void *user_data_or_fixture)
@@ -267,6 +285,885 @@ getproc_complex (const MunitParameter params[], void *user_data_or_fixture)
     return MUNIT_OK; // Pass all requirements
 }
 
+MunitResult
+getproc_steal (const MunitParameter params[], void *user_data_or_fixture)
+{
+    init_scheduler_smp (2);
+    struct pcb_t *proc1 = create_pcb (0, 0, NULL, 0, NULL, 0);
+    struct pcb_t *proc2 = create_pcb (1, 0, NULL, 0, NULL, 0);
+    struct pcb_t *proc3 = create_pcb (2, 0, NULL, 0, NULL, 0);
+
+    proc1->prio = 3;
+    proc2->prio = 3;
+    proc3->prio = 5;
+
+    /* Everything is queued on CPU 1 */
+    put_cpu_proc (1, proc1);
+    put_cpu_proc (1, proc2);
+    put_cpu_proc (1, proc3);
+
+    /* CPU 0 is idle, it steals the tail of CPU 1's highest priority queue
+     * (the front, if the queues are lock-free) */
+#ifdef MLQ_LOCKFREE
+    int stolen = 0, left = 1;
+#else
+    int stolen = 1, left = 0;
+#endif
+    struct pcb_t *get = get_cpu_proc (0);
+    if (get == NULL || get->pid != stolen)
+        {
+            return MUNIT_FAIL;
+        }
+
+    get = get_cpu_proc (1);
+    if (get == NULL || get->pid != left)
+        {
+            return MUNIT_FAIL;
+        }
+
+    get = get_cpu_proc (1);
+    if (get == NULL || get->pid != 2)
+        {
+            return MUNIT_FAIL;
+        }
+
+    if (get_cpu_proc (0) != NULL || queue_empty () != 1)
+        {
+            return MUNIT_FAIL;
+        }
+
+    destroy_pcb (proc1);
+    destroy_pcb (proc2);
+    destroy_pcb (proc3);
+    finish_scheduler ();
+    return MUNIT_OK; // Pass all requirements
+}
+
+MunitResult
+addproc_least_loaded (const MunitParameter params[],
+                      void *user_data_or_fixture)
+{
+    init_scheduler_smp (3);
+    struct pcb_t *proc1 = create_pcb (0, 0, NULL, 0, NULL, 0);
+    struct pcb_t *proc2 = create_pcb (1, 0, NULL, 0, NULL, 0);
+    struct pcb_t *proc3 = create_pcb (2, 0, NULL, 0, NULL, 0);
+    struct pcb_t *proc4 = create_pcb (3, 0, NULL, 0, NULL, 0);
+
+    proc1->prio = 1;
+    proc2->prio = 1;
+    proc3->prio = 1;
+    proc4->prio = 1;
+
+    put_cpu_proc (0, proc1);
+    put_cpu_proc (0, proc2);
+    put_cpu_proc (2, proc3);
+
+    /* CPU 1 is the only CPU with an empty MLQ */
+    add_proc (proc4);
+    struct pcb_t *get = get_cpu_proc (1);
+    if (get == NULL || get->pid != 3)
+        {
+            return MUNIT_FAIL;
+        }
+
+    destroy_pcb (proc1);
+    destroy_pcb (proc2);
+    destroy_pcb (proc3);
+    destroy_pcb (proc4);
+    finish_scheduler ();
+    return MUNIT_OK; // Pass all requirements
+}
+
+/*
+    Run CPU 0 of the CFS for `slots` slots: every dispatched process runs its
+    whole quantum, then is put back. ran[pid] counts the slots of each pid.
+*/
+static void
+cfs_run (int slots, int *ran)
+{
+    while (slots > 0)
+        {
+            struct pcb_t *proc = get_cpu_proc (0);
+            int slice = get_time_slice (0, proc, 0);
+            for (; slice > 0 && slots > 0; slice--, slots--)
+                {
+                    ran[proc->pid]++;
+                    sched_tick (0, proc, 0);
+                }
+            put_cpu_proc (0, proc);
+        }
+}
+
+/*
+    This func tests the CFS shares:
+        - Check that CPU time is shared by weight, MAX_PRIO - prio
+        - Check that a late process is not owed the time it did not exist
+*/
+MunitResult
+cfs_fair_share (const MunitParameter params[], void *user_data_or_fixture)
+{
+    init_scheduler_cfs (1);
+    struct pcb_t *proc1 = create_pcb (0, 0, NULL, 0, NULL, 0);
+    struct pcb_t *proc2 = create_pcb (1, 0, NULL, 0, NULL, 0);
+    struct pcb_t *proc3 = create_pcb (2, 0, NULL, 0, NULL, 0);
+    int ran[3] = { 0, 0, 0 };
+
+    proc1->prio = MAX_PRIO - 100; // weight 100
+    proc2->prio = MAX_PRIO - 50;  // weight 50
+    proc3->prio = MAX_PRIO - 50;
+
+    add_proc (proc1);
+    add_proc (proc2);
+    cfs_run (3000, ran);
+    if (ran[0] < 1900 || ran[0] > 2100) // 2/3 of the CPU
+        {
+            return MUNIT_FAIL;
+        }
+
+    /* proc3 arrives late: it shares from now on, without catching up */
+    ran[0] = ran[1] = 0;
+    add_proc (proc3);
+    cfs_run (4000, ran);
+    if (ran[0] < 1900 || ran[0] > 2100 || ran[2] < 900 || ran[2] > 1100)
+        {
+            return MUNIT_FAIL;
+        }
+
+    finish_scheduler ();
+    destroy_pcb (proc1);
+    destroy_pcb (proc2);
+    destroy_pcb (proc3);
+    return MUNIT_OK; // Pass all requirements
+}
+
+/*
+    This func tests the CFS quantum:
+        - Check that a lone process gets the whole target latency
+        - Check that the quantum shrinks with the load, down to the minimum
+*/
+MunitResult
+cfs_time_slice (const MunitParameter params[], void *user_data_or_fixture)
+{
+    init_scheduler_cfs (1);
+    struct pcb_t *procs[CFS_TARGET_LATENCY];
+    int i;
+
+    for (i = 0; i < CFS_TARGET_LATENCY; i++)
+        {
+            procs[i] = create_pcb (i, 0, NULL, 0, NULL, 0);
+            procs[i]->prio = 0;
+        }
+
+    add_proc (procs[0]);
+    if (get_cpu_proc (0) != procs[0]
+        || get_time_slice (0, procs[0], 0) != CFS_TARGET_LATENCY)
+        {
+            return MUNIT_FAIL;
+        }
+    put_cpu_proc (0, procs[0]);
+
+    add_proc (procs[1]); // 2 equal processes share the latency
+    if (get_time_slice (0, get_cpu_proc (0), 0) != CFS_TARGET_LATENCY / 2)
+        {
+            return MUNIT_FAIL;
+        }
+
+    for (i = 2; i < CFS_TARGET_LATENCY; i++)
+        add_proc (procs[i]);
+    if (get_time_slice (0, get_cpu_proc (0), 0) != CFS_MIN_GRANULARITY)
+        {
+            return MUNIT_FAIL;
+        }
+
+    finish_scheduler ();
+    for (i = 0; i < CFS_TARGET_LATENCY; i++)
+        destroy_pcb (procs[i]);
+    return MUNIT_OK; // Pass all requirements
+}
+
+/*
+    This func tests the policies chosen by name:
+        - Check that an unknown name is rejected
+        - Check that "rr" ignores the priorities
+        - Check that "prio" serves the least prio first, FIFO among equals
+*/
+MunitResult
+policy_by_name (const MunitParameter params[], void *user_data_or_fixture)
+{
+    struct pcb_t *procs[4];
+    uint32_t prios[4] = { 7, 2, 7, 1 };
+    int prio_order[4] = { 3, 1, 0, 2 };
+    int i;
+
+    if (init_scheduler_policy ("nope", 1) != -1)
+        {
+            return MUNIT_FAIL;
+        }
+
+    for (i = 0; i < 4; i++)
+        {
+            procs[i] = create_pcb (i, 0, NULL, 0, NULL, 0);
+            procs[i]->prio = prios[i];
+        }
+
+    init_scheduler_policy ("rr", 2);
+    for (i = 0; i < 4; i++)
+        add_proc (procs[i]);
+    for (i = 0; i < 4; i++)
+        {
+            if (get_cpu_proc (i % 2) != procs[i])
+                {
+                    return MUNIT_FAIL;
+                }
+        }
+    if (queue_empty () != 1 || get_time_slice (0, procs[0], 3) != 3)
+        {
+            return MUNIT_FAIL;
+        }
+    finish_scheduler ();
+
+    init_scheduler_policy ("prio", 2);
+    for (i = 0; i < 4; i++)
+        add_proc (procs[i]);
+    for (i = 0; i < 4; i++)
+        {
+            if (get_cpu_proc (i % 2) != procs[prio_order[i]])
+                {
+                    return MUNIT_FAIL;
+                }
+        }
+    if (queue_empty () != 1)
+        {
+            return MUNIT_FAIL;
+        }
+    finish_scheduler ();
+
+    for (i = 0; i < 4; i++)
+        destroy_pcb (procs[i]);
+    return MUNIT_OK; // Pass all requirements
+}
+
+/*
+    Dispatch from a single CPU, where ten processes of prio 0..9 are always
+    put back, until the process of the lowest priority runs.
+
+    @return The number of dispatches it waited.
+*/
+static int
+aging_wait (int rate)
+{
+    struct pcb_t *procs[11];
+    int i, waited = 0;
+
+    init_scheduler_smp (1);
+    sched_set_aging (rate);
+    for (i = 0; i < 11; i++)
+        {
+            procs[i] = create_pcb (i, 0, NULL, 0, NULL, 0);
+            procs[i]->prio = i < 10 ? i : MAX_PRIO - 1;
+            add_proc (procs[i]);
+        }
+    while (1)
+        {
+            struct pcb_t *proc = get_cpu_proc (0);
+            if (proc == procs[10])
+                break;
+            put_cpu_proc (0, proc);
+            waited++;
+        }
+    finish_scheduler ();
+    sched_set_aging (MLQ_AGING_RATE);
+
+    for (i = 0; i < 11; i++)
+        destroy_pcb (procs[i]);
+    return waited;
+}
+
+/*
+    This func tests the MLQ aging:
+        - Check that a low priority process waits for a whole MLQ cycle
+          without aging
+        - Check that aging bounds its wait by its rate
+        - Check that the lock-free levels refuse to be aged
+*/
+MunitResult
+mlq_aging (const MunitParameter params[], void *user_data_or_fixture)
+{
+    int cycle = 0, prio;
+
+#ifdef MLQ_LOCKFREE
+    if (sched_set_aging (4) != -1 || sched_set_aging (0) != 0)
+        return MUNIT_FAIL;
+    return MUNIT_SKIP;
+#endif
+
+    for (prio = 0; prio < 10; prio++)
+        cycle += MAX_PRIO - prio;
+
+    if (aging_wait (0) != cycle || aging_wait (1) > 2 * MAX_PRIO
+        || aging_wait (4) > 4 * MAX_PRIO + cycle / 2)
+        {
+            return MUNIT_FAIL;
+        }
+    return MUNIT_OK; // Pass all requirements
+}
+
+/*
+    This func tests the EDF class:
+        - Check that the deadline processes run first, earliest first
+        - Check the admission control against EDF_MAX_UTIL of the CPUs
+        - Check that an exited process gives its share back
+        - Check that the length is counted in slots of a clock of
+          instructions, and that a loop is never admitted
+*/
+MunitResult
+edf_admission (const MunitParameter params[], void *user_data_or_fixture)
+{
+    struct code_seg_t code = { NULL, EDF_MAX_UTIL / 2 }; // % of 100 slots
+    struct code_seg_t clocked = { NULL, EDF_MAX_UTIL * 10 - 5 };
+    struct inst_t loop[2] = { { CALC, 0, 0, 0 }, { JNZ, 0, 0, 0 } };
+    struct code_seg_t looping = { loop, 2 };
+    struct pcb_t *procs[4];
+    int i;
+
+    init_scheduler_smp (1);
+    for (i = 0; i < 4; i++)
+        {
+            procs[i] = create_pcb (i, 0, &code, 0, NULL, 0);
+            procs[i]->prio = 0;
+        }
+
+    add_proc (procs[0]); // no deadline
+    if (sched_admit_deadline (procs[1], 10, 100) != 0
+        || sched_admit_deadline (procs[2], 0, 100) != 0
+        || sched_admit_deadline (procs[3], 20, 100) != -1
+        || procs[3]->deadline != 0)
+        {
+            return MUNIT_FAIL;
+        }
+    add_proc (procs[1]);
+    add_proc (procs[2]);
+    add_proc (procs[3]);
+    if (get_cpu_proc (0) != procs[2] || get_time_slice (0, procs[2], 3) != 3
+        || get_cpu_proc (0) != procs[1] || get_cpu_proc (0) != procs[0]
+        || get_cpu_proc (0) != procs[3] || queue_empty () != 1)
+        {
+            return MUNIT_FAIL;
+        }
+
+    sched_exit (0, procs[2]);
+    if (sched_admit_deadline (procs[3], 30, 100) != 0
+        || procs[3]->deadline != 130)
+        {
+            return MUNIT_FAIL;
+        }
+
+    /* All of the share, at 10 instructions a slot */
+    sched_exit (0, procs[1]);
+    sched_exit (0, procs[3]);
+    procs[1]->deadline = procs[2]->deadline = 0;
+    procs[1]->code = &clocked;
+    procs[2]->code = &looping;
+    if (sched_admit_deadline (procs[1], 0, 100) != -1)
+        {
+            return MUNIT_FAIL;
+        }
+    sched_set_clock (10);
+    if (sched_admit_deadline (procs[1], 0, 100) != 0
+        || sched_admit_deadline (procs[2], 0, 1000) != -1)
+        {
+            return MUNIT_FAIL;
+        }
+    sched_exit (0, procs[1]);
+    if (sched_admit_deadline (procs[2], 0, 1000) != -1)
+        {
+            return MUNIT_FAIL;
+        }
+    sched_set_clock (1);
+    finish_scheduler ();
+
+    for (i = 0; i < 4; i++)
+        destroy_pcb (procs[i]);
+    return MUNIT_OK; // Pass all requirements
+}
+
+/*
+    This func tests the MLFQ feedback:
+        - Check that a process using up its quantum is demoted
+        - Check that a process giving the CPU back early is not
+        - Check that the quantum grows with the level, and the periodic
+          boost back to level 0, counted in slots of the simulation
+        - Check that a boosted process is demoted by its next quantum
+*/
+MunitResult
+mlfq_feedback (const MunitParameter params[], void *user_data_or_fixture)
+{
+    int quanta[2] = { 1, 3 };
+    struct pcb_t *cpu_bound = create_pcb (0, 0, NULL, 0, NULL, 0);
+    struct pcb_t *interactive = create_pcb (1, 0, NULL, 0, NULL, 0);
+    struct pcb_t *proc;
+    int i, slice;
+
+    if (sched_set_mlfq_quanta (quanta, 0) != -1
+        || sched_set_mlfq_quanta (quanta, 2) != 0)
+        {
+            return MUNIT_FAIL;
+        }
+    init_scheduler_policy ("mlfq", 1);
+    add_proc (cpu_bound);
+    add_proc (interactive);
+
+    /* cpu_bound runs its whole quantum, interactive gives the CPU back */
+    proc = get_cpu_proc (0);
+    slice = get_time_slice (0, proc, 2);
+    if (proc != cpu_bound || slice != 1)
+        {
+            return MUNIT_FAIL;
+        }
+    sched_tick (0, proc, 0);
+    put_cpu_proc (0, proc);
+    proc = get_cpu_proc (0);
+    if (proc != interactive)
+        {
+            return MUNIT_FAIL;
+        }
+    put_cpu_proc (0, proc);
+    if (cpu_bound->mlfq_level != 1 || interactive->mlfq_level != 0
+        || get_cpu_proc (0) != interactive)
+        {
+            return MUNIT_FAIL;
+        }
+    put_cpu_proc (0, interactive);
+
+    /* The longer quantum at level 1, then the boost */
+    if (get_cpu_proc (0) != interactive || get_cpu_proc (0) != cpu_bound
+        || get_time_slice (0, cpu_bound, 2) != 3)
+        {
+            return MUNIT_FAIL;
+        }
+    /* Two CPUs running in the same slot count it once */
+    for (i = 1; i < MLFQ_BOOST_PERIOD - 1; i++)
+        {
+            sched_tick (0, cpu_bound, i);
+            sched_tick (1, cpu_bound, i);
+        }
+    put_cpu_proc (0, cpu_bound); // stays at the lowest level
+    put_cpu_proc (0, interactive);
+    if (get_cpu_proc (0) != interactive || get_cpu_proc (0) != cpu_bound
+        || cpu_bound->mlfq_level != 1)
+        {
+            return MUNIT_FAIL;
+        }
+    sched_tick (0, cpu_bound, MLFQ_BOOST_PERIOD - 1);
+    put_cpu_proc (0, cpu_bound);
+    put_cpu_proc (0, interactive);
+    if (get_cpu_proc (0) != interactive || cpu_bound->mlfq_level != 0
+        || get_cpu_proc (0) != cpu_bound
+        || get_time_slice (0, cpu_bound, 2) != 1)
+        {
+            return MUNIT_FAIL;
+        }
+    /* Right after the boost, a whole quantum demotes it again */
+    sched_tick (0, cpu_bound, MLFQ_BOOST_PERIOD);
+    put_cpu_proc (0, cpu_bound);
+    if (cpu_bound->mlfq_level != 1)
+        {
+            return MUNIT_FAIL;
+        }
+    finish_scheduler ();
+
+    destroy_pcb (cpu_bound);
+    destroy_pcb (interactive);
+    return MUNIT_OK; // Pass all requirements
+}
+
+/*
+    This func tests the arrival-triggered preemption under the MLQ:
+        - Check that nothing is preempted while a CPU is idle
+        - Check that the CPU running the worst prio is asked to preempt,
+          once, and then dispatches the new process
+        - Check that a less urgent arrival preempts nothing
+*/
+MunitResult
+arrival_preempt (const MunitParameter params[], void *user_data_or_fixture)
+{
+    uint32_t prios[4] = { 5, 9, 1, 7 };
+    struct pcb_t *procs[4];
+    struct pcb_t *worst;
+    int i, victim;
+
+    init_scheduler_smp (2);
+    for (i = 0; i < 4; i++)
+        {
+            procs[i] = create_pcb (i, 0, NULL, 0, NULL, 0);
+            procs[i]->prio = prios[i];
+        }
+
+    add_proc (procs[0]);
+    add_proc (procs[1]);
+    if (sched_need_resched (0) || sched_need_resched (1))
+        {
+            return MUNIT_FAIL;
+        }
+    /* Both CPUs are busy, one of them with prio 9 */
+    worst = get_cpu_proc (0);
+    if (get_cpu_proc (1) == NULL)
+        {
+            return MUNIT_FAIL;
+        }
+    victim = worst == procs[1] ? 0 : 1;
+
+    add_proc (procs[2]); // prio 1 preempts prio 9
+    if (!sched_need_resched (victim) || sched_need_resched (victim)
+        || sched_need_resched (1 - victim))
+        {
+            return MUNIT_FAIL;
+        }
+    put_cpu_proc (victim, procs[1]);
+    if (get_cpu_proc (victim) != procs[2])
+        {
+            return MUNIT_FAIL;
+        }
+
+    add_proc (procs[3]); // prio 7 is worse than 5 and 1
+    if (sched_need_resched (0) || sched_need_resched (1))
+        {
+            return MUNIT_FAIL;
+        }
+    finish_scheduler ();
+
+    for (i = 0; i < 4; i++)
+        destroy_pcb (procs[i]);
+    return MUNIT_OK; // Pass all requirements
+}
+
+/*
+    This func tests the MLQ cycle around a put-back:
+        - Check that a process put back does not rewind the cycle to its
+          level, which is served again in the next cycle
+        - Check that a new process does, while its level has slots left
+*/
+MunitResult
+mlq_requeue_cycle (const MunitParameter params[],
+                   void *user_data_or_fixture)
+{
+    struct pcb_t *procs[4];
+    struct pcb_t *held;
+    int i;
+
+    init_scheduler_smp (1);
+    for (i = 0; i < 4; i++)
+        {
+            procs[i] = create_pcb (i, 0, NULL, 0, NULL, 0);
+            /* 3 slots a cycle for prio MAX_PRIO - 3, 2 for MAX_PRIO - 2 */
+            procs[i]->prio = i == 1 || i == 2 ? MAX_PRIO - 2 : MAX_PRIO - 3;
+        }
+    for (i = 0; i < 3; i++)
+        add_proc (procs[i]);
+
+    held = get_cpu_proc (0); // 1 of the 3 slots of its level
+    if (held != procs[0] || get_cpu_proc (0) != procs[1])
+        {
+            return MUNIT_FAIL;
+        }
+    put_cpu_proc (0, procs[1]);
+    put_cpu_proc (0, held);
+    if (get_cpu_proc (0)->prio != MAX_PRIO - 2) // its level is not over
+        {
+            return MUNIT_FAIL;
+        }
+
+    add_proc (procs[3]);
+    if (get_cpu_proc (0) != procs[0] || get_cpu_proc (0) != procs[3])
+        {
+            return MUNIT_FAIL;
+        }
+    finish_scheduler ();
+
+    for (i = 0; i < 4; i++)
+        destroy_pcb (procs[i]);
+    return MUNIT_OK; // Pass all requirements
+}
+
+/*
+    This func tests the parking of idle CPUs:
+        - Check that a CPU can not park while a process is queued
+        - Check that a new process wakes up its last CPU, or the first one
+*/
+MunitResult
+idle_park (const MunitParameter params[], void *user_data_or_fixture)
+{
+    struct pcb_t *proc = create_pcb (0, 0, NULL, 0, NULL, 0);
+
+    proc->prio = 3;
+    init_scheduler_smp (3);
+    if (sched_park (0) != 0 || sched_park (2) != 0 || !sched_parked (0)
+        || !sched_parked (2) || sched_parked (1))
+        {
+            return MUNIT_FAIL;
+        }
+
+    proc->last_cpu = 2;
+    add_proc (proc);
+    if (!sched_parked (0) || sched_parked (2) || sched_park (2) != -1
+        || sched_parked (2))
+        {
+            return MUNIT_FAIL;
+        }
+    if (get_cpu_proc (2) != proc)
+        {
+            return MUNIT_FAIL;
+        }
+
+    proc->last_cpu = -1;
+    add_proc (proc);
+    if (sched_parked (0))
+        {
+            return MUNIT_FAIL;
+        }
+    finish_scheduler ();
+
+    destroy_pcb (proc);
+    return MUNIT_OK; // Pass all requirements
+}
+
+/*
+    This func tests bringing a CPU offline, under the MLQ:
+        - Check that its queued processes move, in order, to the online CPU
+          instead of waiting to be stolen from the tail
+        - Check that the deadline shares shrink with the online CPUs
+*/
+MunitResult
+cpu_offline (const MunitParameter params[], void *user_data_or_fixture)
+{
+    struct pcb_t *procs[4];
+    struct pcb_t *rt = create_pcb (0, 0, NULL, 0, NULL, 0);
+    int i;
+
+    init_scheduler_smp (2);
+    for (i = 0; i < 4; i++)
+        {
+            procs[i] = create_pcb (0, 0, NULL, 0, NULL, 0);
+            procs[i]->prio = 3;
+            put_cpu_proc (1, procs[i]);
+        }
+    if (sched_set_online (1, 0) != 0 || sched_online (1) || !sched_online (0)
+        || sched_set_online (2, 0) != -1)
+        {
+            return MUNIT_FAIL;
+        }
+    sched_migrate (1);
+    for (i = 0; i < 4; i++)
+        if (get_cpu_proc (0) != procs[i])
+            {
+                return MUNIT_FAIL;
+            }
+
+    /* One CPU is left: a half share fits once, not twice */
+    if (sched_admit_deadline (rt, 0, 2) != 0
+        || sched_admit_deadline (procs[0], 0, 2) != -1)
+        {
+            return MUNIT_FAIL;
+        }
+    finish_scheduler ();
+
+    for (i = 0; i < 4; i++)
+        destroy_pcb (procs[i]);
+    destroy_pcb (rt);
+    return MUNIT_OK; // Pass all requirements
+}
+
+struct mpmc_worker_args
+{
+    struct mpmc_queue_t *q;
+    struct pcb_t *proc;
+    int ops;
+    long popped; // sum of the pids this worker dequeued
+};
+
+static void *
+mpmc_worker (void *args)
+{
+    struct mpmc_worker_args *w = args;
+    for (int i = 0; i < w->ops; i++)
+        {
+            while (mpmc_enqueue (w->q, w->proc) != 0)
+                ;
+            struct pcb_t *get;
+            while ((get = mpmc_dequeue (w->q)) == NULL)
+                ;
+            w->popped += get->pid;
+        }
+    return NULL;
+}
+
+/*
+    Several threads push and pop the lock-free queue concurrently. Every
+    process pushed must be popped exactly once.
+*/
+MunitResult
+mpmc_concurrent (const MunitParameter params[], void *user_data_or_fixture)
+{
+    enum { THREADS = 8, OPS = 20000 };
+    struct mpmc_queue_t q;
+    pthread_t threads[THREADS];
+    struct mpmc_worker_args args[THREADS];
+    long expected = 0, popped = 0;
+
+    if (mpmc_init (&q, 4) != 0) // smaller than THREADS, to hit full cases
+        {
+            return MUNIT_FAIL;
+        }
+
+    for (int i = 0; i < THREADS; i++)
+        {
+            args[i].q = &q;
+            args[i].proc = create_pcb (i + 1, 0, NULL, 0, NULL, 0);
+            args[i].ops = OPS;
+            args[i].popped = 0;
+            expected += (long)(i + 1) * OPS;
+            pthread_create (&threads[i], NULL, mpmc_worker, &args[i]);
+        }
+    for (int i = 0; i < THREADS; i++)
+        {
+            pthread_join (threads[i], NULL);
+            popped += args[i].popped;
+        }
+    for (int i = 0; i < THREADS; i++) // other workers may still hold them
+        destroy_pcb (args[i].proc);
+
+    if (popped != expected || mpmc_dequeue (&q) != NULL)
+        {
+            return MUNIT_FAIL;
+        }
+
+    mpmc_destroy (&q);
+    return MUNIT_OK; // Pass all requirements
+}
+
+/*
+    Benchmark of one get_proc() + put_proc() round trip, while the only ready
+    process sits in the lowest priority queue. This is the worst case of a
+    linear MLQ walk, the cost must stay flat when MAX_PRIO grows
+    (see `make bench-sched`).
+*/
+MunitResult
+bench_getproc_lowest (const MunitParameter params[],
+                      void *user_data_or_fixture)
+{
+    init_scheduler ();
+    struct pcb_t *proc1 = create_pcb (0, 0, NULL, 0, NULL, 0);
+    proc1->prio = MAX_PRIO - 1;
+    put_proc (proc1);
+
+    struct timespec start, end;
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < BENCH_ROUNDS; ++i)
+        {
+            struct pcb_t *get = get_proc ();
+            if (get != proc1)
+                {
+                    return MUNIT_FAIL;
+                }
+            put_proc (get);
+        }
+    clock_gettime (CLOCK_MONOTONIC, &end);
+
+    printf ("MAX_PRIO=%d: %.1f ns per get_proc/put_proc ", MAX_PRIO,
+            elapsed_ns (&start, &end) / BENCH_ROUNDS);
+
+    destroy_pcb (proc1);
+    finish_scheduler ();
+    return MUNIT_OK;
+}
+
+struct contention_args
+{
+    struct queue_t *q; // mutex-protected queue, or
+    struct mpmc_queue_t *lf; // lock-free queue
+    pthread_mutex_t *lock;
+    struct pcb_t *proc;
+};
+
+static void *
+contention_worker (void *args)
+{
+    struct contention_args *c = args;
+    for (int i = 0; i < BENCH_CONTENTION_OPS; i++)
+        {
+            if (c->lf != NULL)
+                {
+                    while (mpmc_enqueue (c->lf, c->proc) != 0)
+                        ;
+                    while (mpmc_dequeue (c->lf) == NULL)
+                        ;
+                }
+            else
+                {
+                    pthread_mutex_lock (c->lock);
+                    enqueue (c->q, c->proc);
+                    pthread_mutex_unlock (c->lock);
+                    pthread_mutex_lock (c->lock);
+                    dequeue (c->q);
+                    pthread_mutex_unlock (c->lock);
+                }
+        }
+    return NULL;
+}
+
+/* Run `nthreads` contention workers, return the throughput in Mops/s */
+static double
+contention_run (int nthreads, int lockfree)
+{
+    pthread_t threads[BENCH_MAX_THREADS];
+    struct contention_args args[BENCH_MAX_THREADS];
+    pthread_mutex_t lock;
+    struct queue_t *q = init_queue ();
+    struct mpmc_queue_t lf;
+    struct pcb_t *proc = create_pcb (0, 0, NULL, 0, NULL, 0);
+    struct timespec start, end;
+
+    pthread_mutex_init (&lock, NULL);
+    mpmc_init (&lf, BENCH_MAX_THREADS);
+
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < nthreads; i++)
+        {
+            args[i].q = q;
+            args[i].lf = lockfree ? &lf : NULL;
+            args[i].lock = &lock;
+            args[i].proc = proc;
+            pthread_create (&threads[i], NULL, contention_worker, &args[i]);
+        }
+    for (int i = 0; i < nthreads; i++)
+        pthread_join (threads[i], NULL);
+    clock_gettime (CLOCK_MONOTONIC, &end);
+
+    mpmc_destroy (&lf);
+    pthread_mutex_destroy (&lock);
+    destroy_pcb (proc);
+    destroy_queue (q);
+    return 2.0 * nthreads * BENCH_CONTENTION_OPS * 1e3
+           / elapsed_ns (&start, &end);
+}
+
+/*
+    Contention benchmark of a ready queue shared by 1 to 64 threads: the
+    mutex-protected queue_t versus the lock-free mpmc_queue_t.
+*/
+MunitResult
+bench_contention (const MunitParameter params[], void *user_data_or_fixture)
+{
+    printf ("\n%8s %14s %14s\n", "threads", "mutex Mops/s", "mpmc Mops/s");
+    for (int n = 1; n <= BENCH_MAX_THREADS; n *= 2)
+        {
+            double mutex_tput = contention_run (n, 0);
+            double mpmc_tput = contention_run (n, 1);
+            printf ("%8d %14.2f %14.2f\n", n, mutex_tput, mpmc_tput);
+        }
+    return MUNIT_OK;
+}
+
 MunitTest tests[]
     = { {
             "MLQ's empty() of Init & Finish: ",         /* name of the test */
@@ -324,6 +1221,110 @@ MunitTest tests[]
             MUNIT_TEST_OPTION_NONE, /* options */
             NULL                    /* parameters to the test func */
         },
+        {
+            "get_cpu_proc() steals from the busiest CPU ", /* name of the test */
+            getproc_steal,          /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "mpmc queue, 8 concurrent threads ", /* name of the test */
+            mpmc_concurrent,        /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "add_proc() picks the least loaded CPU ", /* name of the test */
+            addproc_least_loaded,   /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "CFS shares the CPU by weight ", /* name of the test */
+            cfs_fair_share,         /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "CFS quantum from the target latency ", /* name of the test */
+            cfs_time_slice,         /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "init_scheduler_policy() by name ", /* name of the test */
+            policy_by_name,         /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "MLQ aging bounds the wait ", /* name of the test */
+            mlq_aging,              /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "EDF order and admission control ", /* name of the test */
+            edf_admission,          /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "MLFQ demotion and boost ", /* name of the test */
+            mlfq_feedback,          /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "Preemption by a new process ", /* name of the test */
+            arrival_preempt,        /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "MLQ cycle around a put-back ", /* name of the test */
+            mlq_requeue_cycle,      /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "Parking of idle CPUs ", /* name of the test */
+            idle_park,              /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "/cpu_offline",         /* name */
+            cpu_offline,            /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
         { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } };
 MunitTest test_put_proc[]
     = {{
@@ -335,6 +1336,34 @@ MunitTest test_put_proc[]
             NULL                    /* parameters to the test func */
         }};
 
+MunitTest bench_tests[]
+    = { {
+            "/getproc_lowest_prio", /* name of the test */
+            bench_getproc_lowest,   /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "/queue_contention",    /* name of the test */
+            bench_contention,       /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } };
+
+/* Benchmarks, not run with the tests but alone, by `./test/sched /bench` */
+static const MunitSuite bench_suite = {
+    "/bench",               /* name */
+    bench_tests,            /* MunitTest */
+    NULL,                   /* suites */
+    1,                      /* iterations */
+    MUNIT_SUITE_OPTION_NONE /* options */
+};
+
 static const MunitSuite suite = {
     "",                     /* name */
     tests,                  /* MunitTest */
@@ -346,5 +1375,7 @@ static const MunitSuite suite = {
 int
 main (int argc, char *argv[])
 {
+    if (argc > 1 && strncmp (argv[1], "/bench", 6) == 0)
+        return munit_suite_main (&bench_suite, NULL, argc, argv);
     return munit_suite_main (&suite, NULL, argc, argv);
 }
\ No newline at end of file
@@ -0,0 +1,124 @@
+/**
+ * @file stats.c
+ * @brief
+ *      Unit-test for the scheduling statistics.
+ *
+ */
+
+#include "../include/stats.h"
+#include "../include/common.h"
+#include "../ext/munit.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Definition of test funcs */
+
+/*
+    This func tests `stats_percentile()` by the nearest rank:
+        - Check p50/p90/p99 of 1..100 and of a single value
+        - Check an empty set gives 0
+*/
+MunitResult
+percentile (const MunitParameter params[], void *user_data_or_fixture)
+{
+    uint64_t values[100];
+    for (int i = 0; i < 100; i++)
+        values[i] = i + 1;
+
+    if (stats_percentile (values, 100, 50) != 50
+        || stats_percentile (values, 100, 90) != 90
+        || stats_percentile (values, 100, 99) != 99
+        || stats_percentile (values, 10, 99) != 10
+        || stats_percentile (values, 1, 50) != 1
+        || stats_percentile (values, 0, 50) != 0)
+        {
+            return MUNIT_FAIL;
+        }
+    return MUNIT_OK; // Pass all requirements
+}
+
+/*
+    This func walks a process through its life events:
+        - Check wait, response and turnaround times
+        - Check the CSV line of the process
+*/
+MunitResult
+process_life (const MunitParameter params[], void *user_data_or_fixture)
+{
+    struct pcb_t *proc = create_pcb (7, 0, NULL, 0, NULL, 0);
+    char path[] = "/tmp/stats_test_XXXXXX";
+    char line[256];
+    int fd = mkstemp (path);
+    FILE *file;
+
+    proc->prio = 3;
+    proc->deadline = 20;
+    stats_init (2);
+    stats_arrive (proc, 10);
+    stats_dispatch (1, proc, 12); // waited 2 slots, response 2
+    stats_run (proc, 1);
+    stats_run (proc, 4);
+    stats_put (proc, 14);
+    stats_dispatch (0, proc, 17); // waited 3 more slots
+    stats_run (proc, 2);
+    stats_exit (0, proc, 18);
+
+    if (fd < 0 || stats_write_csv (path) != 0
+        || (file = fopen (path, "r")) == NULL)
+        {
+            return MUNIT_FAIL;
+        }
+    fgets (line, sizeof (line), file); // header
+    fgets (line, sizeof (line), file);
+    fclose (file);
+    remove (path);
+
+    if (strcmp (line, "7,3,0,10,12,18,5,2,8,2,3,7,20\n") != 0)
+        {
+            return MUNIT_FAIL;
+        }
+
+    stats_finish ();
+    destroy_pcb (proc);
+    return MUNIT_OK; // Pass all requirements
+}
+
+/* Configure testcases */
+
+MunitTest tests[]
+    = { {
+            "[0] Percentiles by nearest rank: ", /* name of the test */
+            percentile,                          /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        {
+            "[1] Life of a process: ", /* name of the test */
+            process_life,              /* test func */
+            NULL,                      /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } };
+
+/* Configure the test suite */
+
+static const MunitSuite suite = {
+    "",                     /* name */
+    tests,                  /* MunitTest */
+    NULL,                   /* suites */
+    1,                      /* iterations */
+    MUNIT_SUITE_OPTION_NONE /* options */
+};
+
+/* Start testing */
+
+int
+main (int argc, char *argv[])
+{
+    return munit_suite_main (&suite, NULL, argc, argv);
+}
@@ -0,0 +1,108 @@
+/**
+ * @file timer.c
+ * @brief
+ *      Unit-test for the timing wheel of the timer.
+ *
+ */
+
+#include "../include/timer.h"
+#include "../ext/munit.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NR_EVENTS 12
+
+static uint64_t fired_at[NR_EVENTS]; // slot each event fired at, 0 if not
+static int nr_fired = 0;
+
+static void
+record (void *arg)
+{
+    fired_at[(intptr_t)arg] = current_time ();
+    nr_fired++;
+}
+
+/* Run the clock by hand until `slot`, skipping the empty slots */
+static void
+run_until (uint64_t slot)
+{
+    while (current_time () < slot)
+        step_time (1);
+}
+
+/* Definition of test funcs */
+
+/*
+    This func tests the wheel, stepped by hand as the single-threaded engine
+    does:
+        - Arm events on every level, around the bucket boundaries and past
+          the end of the wheel
+        - Check each fires exactly at its slot, and that the clock jumps
+          straight to it
+        - Check a cancelled event never fires
+*/
+MunitResult
+wheel (const MunitParameter params[], void *user_data_or_fixture)
+{
+    static const uint64_t slots[NR_EVENTS]
+        = { 0,    1,     63,    64,    65,      127,     4095,
+            4096, 70000, 70000, 300000, (1 << 24) + 5 };
+    struct timer_event_t events[NR_EVENTS] = { 0 };
+    struct timer_event_t cancelled = { 0 };
+    int i;
+
+    /* The clock prints every slot it goes through */
+    if (freopen ("/dev/null", "w", stdout) == NULL)
+        return MUNIT_SKIP;
+
+    for (i = NR_EVENTS - 1; i >= 0; i--)
+        schedule_event (&events[i], slots[i], record, (void *)(intptr_t)i);
+    schedule_event (&cancelled, 100, record, (void *)(intptr_t)0);
+    cancel_event (&cancelled);
+
+    start_clock ();
+    if (nr_fired != 1)
+        return MUNIT_FAIL;
+    run_until (slots[NR_EVENTS - 1]);
+    if (nr_fired != NR_EVENTS)
+        return MUNIT_FAIL;
+    for (i = 0; i < NR_EVENTS; i++)
+        if (fired_at[i] != slots[i])
+            return MUNIT_FAIL;
+
+    /* An event for a slot which has begun fires at the next boundary */
+    schedule_event (&events[0], 0, record, (void *)(intptr_t)0);
+    step_time (0);
+    if (nr_fired != NR_EVENTS + 1 || fired_at[0] != slots[NR_EVENTS - 1] + 1)
+        return MUNIT_FAIL;
+    return MUNIT_OK; // Pass all requirements
+}
+
+/* Configure the test suite */
+
+MunitTest tests[]
+    = { {
+            "/wheel",               /* name */
+            wheel,                  /* test func */
+            NULL,                   /* setup func (test constructor) */
+            NULL,                   /* tear_down func (test destructor) */
+            MUNIT_TEST_OPTION_NONE, /* options */
+            NULL                    /* parameters to the test func */
+        },
+        { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL } };
+
+static const MunitSuite suite = {
+    "",                     /* name */
+    tests,                  /* MunitTest */
+    NULL,                   /* suites */
+    1,                      /* iterations */
+    MUNIT_SUITE_OPTION_NONE /* options */
+};
+
+/* Start testing */
+
+int
+main (int argc, char *argv[])
+{
+    return munit_suite_main (&suite, NULL, argc, argv);
+}